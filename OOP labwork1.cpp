@@ -1,16 +1,60 @@
 ﻿#define _USE_MATH_DEFINES
 #include <OOP labwork1.h>
-int main()
+#include <random>
+// Usage: OOP labwork1 [samples] [threads] [float|double|long]
+//        OOP labwork1 raw generator [32|64] [count] [file]
+//        OOP labwork1 bench [samples] [csv|json] [bins]
+int main(int argc, char* argv[])
 {
+    const string mode = argc > 1 ? argv[1] : "";
+    const string usage = "Usage: " + string(argv[0])
+        + (mode == "raw" ? " raw generator [32|64] [count] [file]" : " bench [samples] [csv|json] [bins]");
+    // A number that does not parse, a bad generator or bit count, or a file that cannot be
+    // opened ends the run with the reason and the usage line
+    try {
+        if (mode == "bench") {
+            bench_rng(argc > 2 ? stoull(argv[2]) : 10000000, argc > 4 ? stoul(argv[4]) : 20,
+                      argc > 3 && string(argv[3]) == "json");
+            return 0;
+        }
+        if (mode == "raw") {
+            if (argc < 3) {
+                cerr << usage << endl;
+                return 1;
+            }
+            raw_rng(stoi(argv[2]), argc > 3 ? stoi(argv[3]) : 32, argc > 4 ? stoull(argv[4]) : 0, argc > 5 ? argv[5] : "-");
+            return 0;
+        }
+    } catch (const logic_error& e) {
+        cerr << e.what() << "\n" << usage << endl;
+        return 1;
+    } catch (const runtime_error& e) {
+        cerr << e.what() << "\n" << usage << endl;
+        return 1;
+    }
+    if (argc > 1)
+        sample_count = stoull(argv[1]);
+    if (argc > 2)
+        thread_count = max(1ul, stoul(argv[2]));
+    if (argc > 3)
+        precision = parse_precision(argv[3]);
     int generator_number;
     int number_of_intervals;
     bool check = false;
     while (!check) {
-        cout << "Enter the number between 1-10 in order to choose your RNG\n";
+        cout << "Enter the number between 1-15 in order to choose your RNG\n"
+             << "(11, 12: Ziggurat normal and exponential, 13, 14: compare the normal and gamma samplers,\n"
+             << "15: streaming goodness-of-fit tests of one generator)\n";
         cin >> generator_number;
         cout << "Enter the number of intervals in your RNG\n";
         cin >> number_of_intervals;
-        declare_intervals(number_of_intervals);
+        try {
+            declare_intervals(number_of_intervals);
+        } catch (const invalid_argument& e) {
+            cout << e.what() << ", try again" << endl;
+            continue;
+        }
+        auto start = chrono::steady_clock::now();
         switch (generator_number) {
         case 1:
             first_rng();
@@ -52,294 +96,684 @@ int main()
             tenth_rng();
             check = true;
             break;
+        case 11:
+            eleventh_rng();
+            check = true;
+            break;
+        case 12:
+            twelfth_rng();
+            check = true;
+            break;
+        case 13:
+            compare_normal();
+            check = true;
+            break;
+        case 14:
+            compare_gamma();
+            check = true;
+            break;
+        case 15:
+            test_rng();
+            check = true;
+            break;
         default:
-            cout << "You should enter a positive integer between 1 and 10,try again" << endl;
+            cout << "You should enter a positive integer between 1 and 15,try again" << endl;
+        }
+        if (check) {
+            chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+            cout << sample_count << " samples on " << thread_count << " threads in " << elapsed.count()
+                 << " s, " << sample_count / elapsed.count() << " samples/s" << endl;
         }
     }
     return 0;
 }
 
-ld first_rng(int repeat, bool sum, bool floating) { // WORKS PROPERLY
-    const ull m = 68719476731;
-    ld sum12 = 0;
-    int hist_height = 100000;
-    const int a = 74, c = 75;
-    if (repeat)
-        hist_height = repeat;
-    ull x0 = 1, x = 0;
-    ld d = 1;
-    for (int i = 0; i < hist_height; i++) {
-        if (sum && i > 11)
-            break;
-        x = (a * x0 + c) % m;
-        d = (ld)x / m;
-        sum12 += d;
-        x0 = x;
-        if (!repeat) {
-            for (auto j : intervals_uniform) {
-                if (d >= j.first[0] && d <= j.first[1]) {
-                    intervals_uniform[{j.first[0], j.first[1]}].push_back(d);
-                    break;
-                }
-            }
+// Histogram of sample_count successive values of a uniform engine, converted in batches of
+// the sample type
+template <class Real, class Engine>
+void uniform_rng(Engine engine) {
+    run_parallel(intervals_uniform, [&engine](ull first, ull count, histogram& out) {
+        Engine stream = engine;
+        stream.discard(first);
+        vector<Real> batch(4096);
+        for (ull done = 0; done < count; done += batch.size()) {
+            size_t n = size_t(min<ull>(batch.size(), count - done));
+            stream.fill(batch.data(), n);
+            for (size_t i = 0; i < n; i++)
+                out.add(batch[i]);
         }
-    }
-    if(sum)
-       return sum12;
-    if (!repeat) {
-        show(intervals_uniform);
-        show_interval_frequency(intervals_uniform, hist_height);
-    }
-    if (floating)
-        return d;
-    else
-        return x;
+    });
+    show(intervals_uniform);
+    show_interval_frequency(intervals_uniform, sample_count);
 }
 
-ld second_rng(int repeat, bool sum , bool floating) { // WORKS PROPERLY
-    const ull m = 2097143;
-    ld sum12 = 0;
-    int hist_height = 100000;
-    const int a = 2097144   , c = 49;
-    if (repeat)
-        hist_height = repeat;
-    ld x0 = 1, x = -1;
-    ld d = 1, dd = 8;
-    for (int i = 0; i < hist_height; i++) {
-        if (sum && i > 11)
-            break;
-        x = ull(dd * x0 * x0 + a * x0 + c) % m;
-        d = ld(x / m);
-        x0 = x;
-        sum12 += d;
-        if (!repeat) {
-            for (auto j : intervals_uniform) {
-                if (d >= j.first[0] && d <= j.first[1]) {
-                    intervals_uniform[{j.first[0], j.first[1]}].push_back(d);
-                    break;
+void first_rng() { // WORKS PROPERLY
+    with_precision([](auto real) { uniform_rng<decltype(real)>(lcg_engine()); });
+}
+
+void second_rng() { // WORKS PROPERLY
+    with_precision([](auto real) { uniform_rng<decltype(real)>(quadratic_engine()); });
+}
+
+void third_rng() { // WORKS PROPERLY
+    with_precision([](auto real) { uniform_rng<decltype(real)>(fibonacci_engine()); });
+}
+
+void fourth_rng() { // WORKS PROPERLY
+    with_precision([](auto real) { uniform_rng<decltype(real)>(inverse_engine()); });
+}
+
+void fifth_rng() { // WORKS PROPERLY
+    with_precision([](auto real) { uniform_rng<decltype(real)>(difference_engine()); });
+}
+
+// Every transform below takes a fixed number of values from each engine per sample, so a
+// worker starting at sample first skips first times that many
+
+void sixth_rng() { // WORKS PROPERLY 
+    with_precision([](auto real) {
+        using Real = decltype(real);
+        run_parallel(intervals_normal, [](ull first, ull count, histogram& out) {
+            const int m = 0, sigma = 1;
+            lcg_engine engine;
+            engine.discard(first * 12);
+            for (ull i = 0; i < count; i++)
+                out.add(m + sum12_normal<Real>(engine) * sigma);
+        });
+    });
+    show(intervals_normal);
+    show_interval_frequency(intervals_normal, sample_count);
+}
+
+void seventh_rng() { // WORKS PROPERLY 
+    with_precision([](auto real) {
+        using Real = decltype(real);
+        run_parallel(intervals_normal, [](ull first_sample, ull count, histogram& out) {
+            lcg_engine first;
+            quadratic_engine second;
+            first.discard(first_sample);
+            second.discard(first_sample);
+            Real x1, x2;
+            for (ull i = 0; i < count; i++) {
+                if (polar_normal(first, second, x1, x2)) {
+                    out.add(x1);
+                    out.add(x2);
                 }
             }
-        }
-    }
-    if ((repeat && sum) || sum)
-        return sum12;
-    if (!repeat) {
-        show(intervals_uniform);
-        show_interval_frequency(intervals_uniform, hist_height);
-    }
-    if (floating)
-        return d;
-    else
-        return x;
+        });
+    });
+    show(intervals_normal);
+    show_interval_frequency(intervals_normal, sample_count);
 }
 
-ld third_rng(int repeat, bool sum , bool floating) { // WORKS PROPERLY
-    const ull m = 131071;
-    int hist_height = 100000;
-    if (repeat)
-        hist_height = repeat;
-    ull x0 = 1, x1 = 2, x = 1;
-    ld d = 1, sum12 = 0;
-    for (int i = 0; i < hist_height; i++) {
-        if (sum && i > 11)
-            break;
-        x = (x0 + x1) % m;
-        d = (ld)x / m;
-        x0 = x1;
-        x1 = x;
-        sum12 += d;
-        if (!repeat) {
-            for (auto j : intervals_uniform) {
-                if (d >= j.first[0] && d <= j.first[1]) {
-                    intervals_uniform[{j.first[0], j.first[1]}].push_back(d);
-                    break;
-                }
+void eighth_rng() { // WORKS PROPERLY 
+    with_precision([](auto real) {
+        using Real = decltype(real);
+        run_parallel(intervals_normal, [](ull first, ull count, histogram& out) {
+            fibonacci_engine third;
+            inverse_engine fourth;
+            third.discard(first);
+            fourth.discard(first);
+            Real x;
+            for (ull i = 0; i < count; i++) {
+                if (ratio_normal(third, fourth, x))
+                    out.add(x);
             }
-        }
-    }
-    if ((repeat && sum) || sum)
-        return sum12;
-    if (!repeat) {
-        show(intervals_uniform);
-        show_interval_frequency(intervals_uniform, hist_height);
-    }
-    if (floating)
-        return d;
-    else
-        return x;
+        });
+    });
+    show(intervals_normal);
+    show_interval_frequency(intervals_normal, sample_count);
 }
 
-ld fourth_rng(int repeat, bool sum , bool floating) { // WORKS PROPERLY
-    const ull m = 16381;
-    int hist_height = 100000;
-    if (repeat)
-        hist_height = repeat;
-    ull x0 = 1, x;
-    ull a = 101, c = 103;
-    ld d = 1, sum12 = 0;
-    for (int i = 0; i < hist_height; i++) {
-        if (sum && i > 11)
-            break;
-        x = (a * x0 + c) % m;
-        if (m % x != 0)
-            x0 = modInverse(x, m);
-        d = (ld)x / m;
-        x0 = x;
-        if (!repeat) {
-            for (auto j : intervals_uniform) {
-                if (d >= j.first[0] && d <= j.first[1]) {
-                    intervals_uniform[{j.first[0], j.first[1]}].push_back(d);
-                    break;
-                }
+void nineth_rng() { // WORKS PROPERLY 
+    with_precision([](auto real) {
+        using Real = decltype(real);
+        run_parallel(intervals_other9, [](ull first, ull count, histogram& out) {
+            lcg_engine engine;
+            engine.discard(first);
+            Real x, u, miu = Real(0.1);
+            for (ull i = 0; i < count; i++) {
+                u = uniform<Real>(engine);
+                x = -miu * log(u);
+                out.add(x);
             }
+        });
+    });
+    show(intervals_other9);
+    show_interval_frequency(intervals_other9, sample_count);
+}
+
+// The Ziggurat and gamma samplers take a varying number of values per sample, so they cannot
+// be positioned by sample index. They run in blocks of sample_block samples instead, block b
+// drawing from position b * sample_block * sample_stride of the engine: sample_stride values
+// per sample is far more than the 1 to 3 they use on average, so the blocks do not overlap.
+const ull sample_block = 1 << 16, sample_stride = 8;
+
+template <class Distribution, class Real>
+void block_rng(histogram& intervals, Distribution distribution, Real scale) {
+    run_parallel(intervals, [&distribution, scale](ull first, ull count, histogram& out) {
+        Distribution sampler = distribution;
+        for (ull block = first; block < first + count; block += sample_block) {
+            lcg_engine engine;
+            engine.discard(block * sample_stride);
+            for (ull i = block; i < min(first + count, block + sample_block); i++)
+                out.add(scale * sampler(engine));
         }
+    }, sample_block);
+    show(intervals);
+    show_interval_frequency(intervals, sample_count);
+}
+
+void tenth_rng() { // WORKS PROPERLY
+    with_precision([](auto real) {
+        using Real = decltype(real);
+        const int a = 20;
+        block_rng(intervals_other10, gamma_sampler<Real>(a), Real(1));
+    });
+}
+
+void eleventh_rng() {
+    with_precision([](auto real) {
+        using Real = decltype(real);
+        block_rng(intervals_normal, ziggurat_normal<Real>(), Real(1));
+    });
+}
+
+void twelfth_rng() {
+    with_precision([](auto real) {
+        using Real = decltype(real);
+        const Real miu = Real(0.1);
+        block_rng(intervals_other9, ziggurat_exponential<Real>(), miu);
+    });
+}
+
+// Side-by-side cost and accuracy of the normal samplers: sample_count normals from each on
+// one thread in the chosen precision, the time per normal including rejected attempts, and
+// the chi-square of the histogram against the normal distribution
+void compare_normal() {
+    struct method {
+        string name;
+        function<void(histogram&)> run;
+    };
+    const ull n = sample_count;
+    vector<method> methods;
+    with_precision([n, &methods](auto real) {
+        using Real = decltype(real);
+        methods = {
+            { "sum of 12 (6)", [n](histogram& out) {
+                lcg_engine engine;
+                for (ull i = 0; i < n; i++)
+                    out.add(sum12_normal<Real>(engine));
+            } },
+            { "polar (7)", [n](histogram& out) {
+                lcg_engine first;
+                quadratic_engine second;
+                Real x1, x2;
+                for (ull i = 0; i < n; i += 2) {
+                    while (!polar_normal(first, second, x1, x2)) {}
+                    out.add(x1);
+                    if (i + 1 < n)
+                        out.add(x2);
+                }
+            } },
+            { "ratio of uniforms (8)", [n](histogram& out) {
+                fibonacci_engine third;
+                inverse_engine fourth;
+                Real x;
+                for (ull i = 0; i < n; i++) {
+                    while (!ratio_normal(third, fourth, x)) {}
+                    out.add(x);
+                }
+            } },
+            { "ziggurat (11)", [n](histogram& out) {
+                lcg_engine engine;
+                ziggurat_normal<Real> normal;
+                for (ull i = 0; i < n; i++)
+                    out.add(normal(engine));
+            } },
+        };
+    });
+
+    cout << left << setw(24) << "method" << right << setw(12) << "ns/sample" << setw(14) << "chi-square"
+         << setw(6) << "dof" << setw(12) << "p-value" << "\n";
+    for (const auto& m : methods) {
+        histogram counts = intervals_normal;
+        counts.clear();
+        auto start = chrono::steady_clock::now();
+        m.run(counts);
+        chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+        size_t cells;
+        ld statistic = chi_square(counts, n, normal_cdf, cells);
+        ld dof = cells - 1;
+        cout << left << setw(24) << m.name << right << fixed << setprecision(2) << setw(12) << elapsed.count() / n
+             << setw(14) << statistic << setw(6) << setprecision(0) << dof << setw(12) << setprecision(4)
+             << chi_square_p(statistic, dof) << defaultfloat << setprecision(6) << "\n";
     }
-    if ((repeat && sum) || sum)
-        return sum12;
-    if (!repeat) {
-        show(intervals_uniform);
-        show_interval_frequency(intervals_uniform, hist_height);
+}
+
+// The same comparison for Gamma(20): the Cauchy rejection tenth_rng used before and the
+// Marsaglia-Tsang sampler it uses now
+void compare_gamma() {
+    struct method {
+        string name;
+        function<void(histogram&)> run;
+    };
+    const int a = 20;
+    const ull n = sample_count;
+    vector<method> methods;
+    with_precision([n, &methods](auto real) {
+        using Real = decltype(real);
+        methods = {
+            { "cauchy rejection", [n](histogram& out) {
+                lcg_engine first;
+                quadratic_engine second;
+                Real x;
+                for (ull i = 0; i < n; i++) {
+                    while (!cauchy_gamma(first, second, a, x)) {}
+                    out.add(x);
+                }
+            } },
+            { "marsaglia-tsang (10)", [n](histogram& out) {
+                lcg_engine engine;
+                gamma_sampler<Real> gamma(a);
+                for (ull i = 0; i < n; i++)
+                    out.add(gamma(engine));
+            } },
+        };
+    });
+
+    cout << left << setw(24) << "method" << right << setw(12) << "ns/sample" << setw(14) << "chi-square"
+         << setw(6) << "dof" << setw(12) << "p-value" << "\n";
+    for (const auto& m : methods) {
+        histogram counts = intervals_other10;
+        counts.clear();
+        auto start = chrono::steady_clock::now();
+        m.run(counts);
+        chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+        size_t cells;
+        ld statistic = chi_square(counts, n, [](ld x) { return regularized_gamma_p(a, x); }, cells);
+        ld dof = cells - 1;
+        cout << left << setw(24) << m.name << right << fixed << setprecision(2) << setw(12) << elapsed.count() / n
+             << setw(14) << statistic << setw(6) << setprecision(0) << dof << setw(12) << setprecision(4)
+             << chi_square_p(statistic, dof) << defaultfloat << setprecision(6) << "\n";
     }
-    if (floating)
-        return d;
-    else
-        return x;
 }
 
-ld fifth_rng(const int repeat, const bool sum, const int offset) { // WORKS PROPERLY
-    const ull m = 68719476731;
-    int hist_height = 100000;
-    if (repeat)
-        hist_height = repeat;
-    ull x;
-    ld d = 1, sum12 = 0;
-    for (int i = 0; i < hist_height; i++) {
-        if (sum && i > 11)
-            break;
-        x = ull((first_rng(i % 1000 + 11 + offset) - second_rng(i % 1000 + 13 + offset))) % m;
-        d = ld(x) / m;
-        sum12 += d;
-        if (!repeat) {
-            for (auto j : intervals_uniform) {
-                if (d >= j.first[0] && d <= j.first[1]) {
-                    intervals_uniform[{j.first[0], j.first[1]}].push_back(d);
-                    break;
+// Generator g (1-12) as a source of batches: each call writes the next n samples, rejected
+// attempts left out. Wrap<Engine> replaces each engine, e.g. to count the values drawn.
+template <class Real, template <class> class Wrap = plain_engine>
+function<void(Real*, size_t)> sample_source(int g) {
+    const Real miu = Real(0.1);
+    const int a = 20;
+    switch (g) {
+    case 1:
+        return [engine = Wrap<lcg_engine>()](Real* out, size_t n) mutable { engine.fill(out, n); };
+    case 2:
+        return [engine = Wrap<quadratic_engine>()](Real* out, size_t n) mutable { engine.fill(out, n); };
+    case 3:
+        return [engine = Wrap<fibonacci_engine>()](Real* out, size_t n) mutable { engine.fill(out, n); };
+    case 4:
+        return [engine = Wrap<inverse_engine>()](Real* out, size_t n) mutable { engine.fill(out, n); };
+    case 5:
+        return [engine = Wrap<difference_engine>()](Real* out, size_t n) mutable { engine.fill(out, n); };
+    case 6:
+        return [engine = Wrap<lcg_engine>()](Real* out, size_t n) mutable {
+            for (size_t i = 0; i < n; i++)
+                out[i] = sum12_normal<Real>(engine);
+        };
+    case 7:
+        return [first = Wrap<lcg_engine>(), second = Wrap<quadratic_engine>()](Real* out, size_t n) mutable {
+            Real x1, x2;
+            for (size_t i = 0; i < n;) {
+                if (polar_normal(first, second, x1, x2)) {
+                    out[i++] = x1;
+                    if (i < n)
+                        out[i++] = x2;
                 }
             }
-        }
-    }
-    if (sum) {
-        return sum12;
+        };
+    case 8:
+        return [third = Wrap<fibonacci_engine>(), fourth = Wrap<inverse_engine>()](Real* out, size_t n) mutable {
+            for (size_t i = 0; i < n; i++)
+                while (!ratio_normal(third, fourth, out[i])) {}
+        };
+    case 9:
+        return [engine = Wrap<lcg_engine>(), miu](Real* out, size_t n) mutable {
+            for (size_t i = 0; i < n; i++)
+                out[i] = -miu * log(uniform<Real>(engine));
+        };
+    case 10:
+        return [engine = Wrap<lcg_engine>(), gamma = gamma_sampler<Real>(a)](Real* out, size_t n) mutable {
+            for (size_t i = 0; i < n; i++)
+                out[i] = gamma(engine);
+        };
+    case 11:
+        return [engine = Wrap<lcg_engine>(), normal = ziggurat_normal<Real>()](Real* out, size_t n) mutable {
+            for (size_t i = 0; i < n; i++)
+                out[i] = normal(engine);
+        };
+    default:
+        return [engine = Wrap<lcg_engine>(), exponential = ziggurat_exponential<Real>(), miu](Real* out, size_t n) mutable {
+            for (size_t i = 0; i < n; i++)
+                out[i] = miu * exponential(engine);
+        };
     }
-    if (!repeat) {
-        show(intervals_uniform);
-        show_interval_frequency(intervals_uniform, hist_height);
+}
+
+// The intervals generator g (1-12) is shown on, and the distribution function of its samples
+const histogram& intervals_of(int g) {
+    return g <= 5 ? intervals_uniform
+        : g == 9 || g == 12 ? intervals_other9
+        : g == 10 ? intervals_other10
+        : intervals_normal;
+}
+
+function<ld(ld)> cdf_of(int g) {
+    if (g <= 5)
+        return [](ld x) { return min(max(x, 0.0L), 1.0L); };
+    if (g == 9 || g == 12)
+        return [](ld x) { return x > 0 ? -expm1l(-x / 0.1L) : 0.0L; };
+    if (g == 10)
+        return [](ld x) { return regularized_gamma_p(20, x); };
+    return normal_cdf;
+}
+
+// Streams sample_count samples of one generator through the goodness-of-fit tests, which run
+// on a background thread while the next batch is generated. The chi-square uses as many
+// cells as the intervals, and nothing is stored, so any sample_count fits in memory.
+void test_rng() {
+    int g;
+    cout << "Enter the generator to test (1-12)\n";
+    cin >> g;
+    if (g < 1 || g > 12) {
+        cout << "There is no generator " << g << endl;
+        return;
     }
-    return d;
+    const histogram& intervals = intervals_of(g);
+    stream_tests tests(intervals.lower(0), intervals.upper(intervals.bins() - 1), cdf_of(g), intervals.bins());
+    double generating = 0, testing = 0;
+    with_precision([g, &tests, &generating, &testing](auto real) {
+        using Real = decltype(real);
+        auto source = sample_source<Real>(g);
+        batch_pipe<Real> pipe([&tests](const Real* x, size_t n) { tests.add(x, n); });
+        for (ull done = 0; done < sample_count;) {
+            size_t n = size_t(min<ull>(pipe.batch_size(), sample_count - done));
+            Real* batch = pipe.acquire();
+            auto start = chrono::steady_clock::now();
+            source(batch, n);
+            generating += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            pipe.submit(n);
+            done += n;
+        }
+        pipe.finish();
+        testing = pipe.busy_seconds();
+    });
+    tests.report(cout);
+    cout << "generation " << generating << " s, tests " << testing << " s on the background thread" << endl;
 }
 
-void sixth_rng() { // WORKS PROPERLY 
-    int hist_height = 100000;
-    const int m = 0, sigma = 1;
-    ld x, sum = 0;
-    for (int i = 0; i < hist_height; i++) {
-        sum = first_rng(i, true, i);
-        x = m + (sum - 6) * sigma;
-        for (auto j : intervals_normal) {
-            if (x >= j.first[0] && x <= j.first[1]) {
-                intervals_normal[{j.first[0], j.first[1]}].push_back(x);
-                break;
+// Generator 1-5 as a source of 32-bit words: the top 32 bits of each value, or narrower
+// values packed together as random_word does, from one batch fill of all the values
+template <class Engine>
+function<void(uint32_t*, size_t)> word_source(Engine engine) {
+    return [engine, values = vector<uint32_t>()](uint32_t* out, size_t n) mutable {
+        constexpr int width = bit_width(Engine::max() - Engine::min());
+        if constexpr (width >= 32) {
+            engine.fill(out, n);
+        } else {
+            constexpr int per_word = (32 + width - 1) / width;
+            values.resize(per_word * n);
+            engine.fill(values.data(), values.size());
+            for (size_t i = 0; i < n; i++) {
+                ull word = 0;
+                for (int k = 0; k < per_word; k++)
+                    word = (word << width) | values[per_word * i + k];
+                out[i] = uint32_t(word);
             }
         }
+    };
+}
+
+// Writes count values of source to output, or values until the output fails when count is 0,
+// in batches of 1 MB through batch_pipe so the next batch is generated during the write.
+// Returns the bytes of the batches written in full, short of count values when the output
+// failed.
+template <class T>
+ull stream_raw(raw_output& output, function<void(T*, size_t)> source, ull count) {
+    atomic<bool> failed(false);
+    ull written = 0;
+    batch_pipe<T> pipe([&output, &failed, &written](const T* data, size_t n) {
+        if (failed)
+            return;
+        if (output.write(data, n * sizeof(T)))
+            written += n * sizeof(T);
+        else
+            failed = true;
+    }, 4, (1 << 20) / sizeof(T));
+    for (ull done = 0; (count == 0 || done < count) && !failed;) {
+        size_t n = count == 0 ? pipe.batch_size() : size_t(min<ull>(pipe.batch_size(), count - done));
+        T* batch = pipe.acquire();
+        source(batch, n);
+        pipe.submit(n);
+        done += n;
     }
-    show(intervals_normal);
-    show_interval_frequency(intervals_normal, hist_height);
+    pipe.finish();
+    return written;
 }
 
-void seventh_rng() { // WORKS PROPERLY 
-    int hist_height = 100000;
-    long double v1, v2, u1, u2, x1, x2, s;
-    for (int i = 0; i < hist_height; i++) {
-        u1 = first_rng(i % 1000 + 1, false, true);
-        u2 = second_rng(i % 1000 + 5, false, true);
-        v1 = 2 * u1 - 1;
-        v2 = 2 * u2 - 1;
-        s = v1 * v1 + v2 * v2;
-        if (s < 1) {
-            x1 = v1 * sqrtl(-2 * log(s) / s);
-            x2 = v2 * sqrtl(-2 * log(s) / s);
-            for (auto i : intervals_normal) {
-                if (x1 >= i.first[0] && x1 <= i.first[1]) {
-                    intervals_normal[{i.first[0], i.first[1]}].push_back(x1);
-                }
-                if (x2 >= i.first[0] && x2 <= i.first[1]) {
-                    intervals_normal[{i.first[0], i.first[1]}].push_back(x2);
-                    break;
-                }
-            }
-        }
+// Raw binary output of count words (0: until the output is closed) for external test
+// batteries, e.g. PractRand's RNG_test stdin32 or TestU01 reading a file. Generators 1-5
+// write 32-bit words; a 64-bit word is two of them, low half first, so the bytes are the
+// same and only the count differs. Generators 6-12 are not uniform, so they write their
+// samples as raw float (32) or double (64) instead, for checks against their distribution.
+void raw_rng(int g, int bits, ull count, const string& path) {
+    if (g < 1 || g > 12)
+        throw invalid_argument("there is no generator " + to_string(g));
+    if (bits != 32 && bits != 64)
+        throw invalid_argument("words must be 32 or 64 bits, not " + to_string(bits));
+    raw_output output(path);
+    auto start = chrono::steady_clock::now();
+    ull words = bits == 64 ? 2 * count : count, written;
+    switch (g) {
+    case 1:
+        written = stream_raw(output, word_source(lcg_engine()), words);
+        break;
+    case 2:
+        written = stream_raw(output, word_source(quadratic_engine()), words);
+        break;
+    case 3:
+        written = stream_raw(output, word_source(fibonacci_engine()), words);
+        break;
+    case 4:
+        written = stream_raw(output, word_source(inverse_engine()), words);
+        break;
+    case 5:
+        written = stream_raw(output, word_source(difference_engine()), words);
+        break;
+    default:
+        if (bits == 32)
+            written = stream_raw(output, sample_source<float>(g), count);
+        else
+            written = stream_raw(output, sample_source<double>(g), count);
     }
-    show(intervals_normal);
-    show_interval_frequency(intervals_normal, hist_height);
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    cerr << written << " bytes in " << elapsed.count() << " s, " << written / elapsed.count() / 1e9 << " GB/s" << endl;
+    // With no count the run ends when the reader closes the output; with one that is an error
+    if (count != 0 && written < count * (bits / 8))
+        throw runtime_error("the output failed after " + to_string(written) + " bytes");
 }
 
-void eighth_rng() { // WORKS PROPERLY 
-    int hist_height = 100000;
-    long double v, u, x;
-    for (int i = 0; i < hist_height; i++) {
-        u = third_rng(i % 1400 + 1, false, true);
-        v = fourth_rng(i % 1400 + 5, false, true);
-        x = sqrtl(8 / M_E) * ((v - 0.5) / u);
-        if (((x * x) <= 5 - 4 * exp(0.25) * u) && (x * x) < ((4 * exp(-1.35) / u) + 1.4) && ((x * x) <= -4 * log(u))) {
-            for (auto i : intervals_normal) {
-                if (x >= i.first[0] && x <= i.first[1]) {
-                    intervals_normal[{i.first[0], i.first[1]}].push_back(x);
-                    break;
-                }
-            }
-        }
+// ns per value of n calls to engine()
+template <class Engine>
+double call_ns(Engine engine, ull n) {
+    ull sum = 0;
+    auto start = chrono::steady_clock::now();
+    for (ull i = 0; i < n; i++)
+        sum += engine();
+    chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+    volatile ull sink = sum;
+    (void)sink;
+    return elapsed.count() / n;
+}
+
+// ns per value of n values from engine.fill() as 32-bit words, in batches of 4096
+template <class Engine>
+double fill_ns(Engine engine, ull n) {
+    vector<uint32_t> batch(4096);
+    ull sum = 0;
+    auto start = chrono::steady_clock::now();
+    for (ull done = 0; done < n; done += batch.size()) {
+        size_t k = size_t(min<ull>(batch.size(), n - done));
+        engine.fill(batch.data(), k);
+        sum += batch[0];
     }
-    show(intervals_normal);
-    show_interval_frequency(intervals_normal, hist_height);
+    chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+    volatile ull sink = sum;
+    (void)sink;
+    return elapsed.count() / n;
 }
 
-void nineth_rng() { // WORKS PROPERLY 
-    int hist_height = 100000;
-    ld x, u, miu = 0.1;
-    for (int i = 1; i < hist_height; i++) {
-        u = first_rng(i % 1000 + 11, false, true);
-        x = -miu * log(u);
-        for (auto i : intervals_other9) {
-            if (x >= i.first[0] && x <= i.first[1]) {
-                intervals_other9[{i.first[0], i.first[1]}].push_back(x);
-                break;
-            }
-        }
+// Whether engine.fill() gives exactly the values fill_scalar does, over batch sizes that leave
+// every length of tail after the vector kernels
+template <class T, class Engine>
+bool fill_matches_scalar(Engine engine) {
+    Engine reference = engine;
+    vector<T> batch(4096 + 23), expected(batch.size());
+    for (size_t k : { size_t(1), size_t(15), size_t(16), size_t(17), size_t(1000), batch.size() }) {
+        engine.fill(batch.data(), k);
+        fill_scalar(reference, expected.data(), k);
+        if (!equal(batch.begin(), batch.begin() + k, expected.begin()))
+            return false;
     }
-    show(intervals_other9);
-    show_interval_frequency(intervals_other9, hist_height);
+    return true;
 }
 
-void tenth_rng() { // WORKS PROPERLY
-    int hist_height = 100000;
-    const int a = 20;
-    long double d, u, v, x, y;
-    for (int i = 0; i < hist_height; i++) {
-        u = first_rng(i % 2000 + 1, false, true);
-        y = tan(M_PI * u);
-        x = sqrtl(2 * a - 1) * y + a - 1;
-        if (x <= 0)
-            continue;
-        v = second_rng(i % 2000 + 5, false, true);
-        if (v <= ((1 + y * y) * exp((a - 1) * log(x / (a - 1)) - sqrtl(2 * a - 1) * y))) {
-            for (auto i : intervals_other10) {
-                if (x >= i.first[0] && x <= i.first[1]) {
-                    intervals_other10[{i.first[0], i.first[1]}].push_back(x);
-                    break;
-                }
-            }
+template <class Engine>
+void check_fill(Engine engine, const string& name) {
+    if (!fill_matches_scalar<float>(engine) || !fill_matches_scalar<double>(engine) || !fill_matches_scalar<uint32_t>(engine))
+        cerr << "warning: " << name << " fill() differs from fill_scalar" << endl;
+}
+
+// Values drawn from the engines per sample of generator g, over n samples
+double values_per_sample(int g, ull n) {
+    auto source = sample_source<double, counting_engine>(g);
+    vector<double> batch(4096);
+    values_drawn = 0;
+    for (ull done = 0; done < n; done += batch.size())
+        source(batch.data(), size_t(min<ull>(batch.size(), n - done)));
+    return double(values_drawn) / n;
+}
+
+// Cost and quality of every generator on one thread, from the default seeds, with
+// std::mt19937_64 converted to [0, 1) as the baseline. Each is timed after one untimed batch,
+// which also builds any static tables, and the batch fills are first checked against
+// fill_scalar. Per sample:
+//  - generate: time in the engines alone, the values drawn per sample times the cost of one
+//    value (a batch fill of 32-bit words for the uniform generators, engine() otherwise)
+//  - transform: the rest of the time to produce the samples, conversion to double included;
+//    slightly negative when the transform hides part of the engine's latency
+//  - bin: adding the samples to the generator's histogram
+// and the chi-square of that histogram against the generator's distribution. The table is
+// CSV, or JSON with json set.
+void bench_rng(ull n, size_t bins, bool json) {
+    if (n == 0)
+        throw invalid_argument("the number of samples must be at least 1");
+    if (bins == 0)
+        throw invalid_argument("the number of bins must be at least 1");
+    declare_intervals(bins);
+    const ull counted = min<ull>(n, 1 << 20);
+    inverse_engine()();
+    check_fill(lcg_engine(), "lcg");
+    check_fill(quadratic_engine(), "quadratic");
+    check_fill(fibonacci_engine(), "fibonacci");
+    check_fill(inverse_engine(), "inverse");
+    check_fill(difference_engine(), "difference");
+    const double lcg = call_ns(lcg_engine(), n), quadratic = call_ns(quadratic_engine(), n);
+    const double fibonacci = call_ns(fibonacci_engine(), n), inverse = call_ns(inverse_engine(), n);
+    const vector<string> names = { "mt19937_64", "lcg (1)", "quadratic (2)", "fibonacci (3)", "inverse (4)",
+        "difference (5)", "sum of 12 (6)", "polar (7)", "ratio of uniforms (8)", "exponential by log (9)",
+        "gamma marsaglia-tsang (10)", "ziggurat normal (11)", "ziggurat exponential (12)" };
+
+    if (json)
+        cout << "{\"samples\": " << n << ", \"bins\": " << bins << ", \"generators\": [\n";
+    else
+        cout << "generator,values_per_sample,generate_ns,transform_ns,bin_ns,total_ns,samples_per_s,chi_square,dof,p_value\n";
+    for (int g = 0; g <= 12; g++) {
+        function<void(double*, size_t)> source;
+        double value_ns, values = 1;
+        switch (g) {
+        case 0:
+            source = [engine = mt19937_64()](double* out, size_t k) mutable { fill_scalar(engine, out, k); };
+            value_ns = call_ns(mt19937_64(), n);
+            break;
+        case 1:
+            value_ns = fill_ns(lcg_engine(), n);
+            break;
+        case 2:
+            value_ns = fill_ns(quadratic_engine(), n);
+            break;
+        case 3:
+            value_ns = fill_ns(fibonacci_engine(), n);
+            break;
+        case 4:
+            value_ns = fill_ns(inverse_engine(), n);
+            break;
+        case 5:
+            value_ns = fill_ns(difference_engine(), n);
+            break;
+        case 7:
+            value_ns = (lcg + quadratic) / 2;
+            break;
+        case 8:
+            value_ns = (fibonacci + inverse) / 2;
+            break;
+        default:
+            value_ns = lcg;
+        }
+        if (g > 0)
+            source = sample_source<double>(g);
+        if (g > 5)
+            values = values_per_sample(g, counted);
+
+        histogram counts = g > 0 ? intervals_of(g) : intervals_uniform;
+        counts.clear();
+        vector<double> batch(4096);
+        source(batch.data(), batch.size());
+        double sample_ns = 0, bin_ns = 0;
+        for (ull done = 0; done < n; done += batch.size()) {
+            size_t k = size_t(min<ull>(batch.size(), n - done));
+            auto start = chrono::steady_clock::now();
+            source(batch.data(), k);
+            auto generated = chrono::steady_clock::now();
+            for (size_t i = 0; i < k; i++)
+                counts.add(batch[i]);
+            sample_ns += chrono::duration<double, nano>(generated - start).count();
+            bin_ns += chrono::duration<double, nano>(chrono::steady_clock::now() - generated).count();
+        }
+        sample_ns /= n;
+        bin_ns /= n;
+        double generate_ns = values * value_ns, total_ns = sample_ns + bin_ns;
+        size_t cells;
+        ld statistic = chi_square(counts, n, cdf_of(g > 0 ? g : 1), cells);
+        size_t dof = cells - 1;
+        ld p = chi_square_p(statistic, dof);
+
+        cout << fixed;
+        if (json) {
+            cout << "  {\"generator\": \"" << names[g] << "\", \"values_per_sample\": " << setprecision(4) << values
+                 << ", \"generate_ns\": " << setprecision(3) << generate_ns << ", \"transform_ns\": "
+                 << sample_ns - generate_ns << ", \"bin_ns\": " << bin_ns << ", \"total_ns\": " << total_ns
+                 << ", \"samples_per_s\": " << setprecision(0) << 1e9 / total_ns << ", \"chi_square\": "
+                 << setprecision(2) << statistic << ", \"dof\": " << dof << ", \"p_value\": " << setprecision(4) << p
+                 << "}" << (g < 12 ? ",\n" : "\n");
+        } else {
+            cout << names[g] << "," << setprecision(4) << values << "," << setprecision(3) << generate_ns << ","
+                 << sample_ns - generate_ns << "," << bin_ns << "," << total_ns << "," << setprecision(0)
+                 << 1e9 / total_ns << "," << setprecision(2) << statistic << "," << dof << "," << setprecision(4)
+                 << p << "\n";
         }
+        cout << defaultfloat << setprecision(6);
     }
-    show(intervals_other10);
-    show_interval_frequency(intervals_other10, hist_height);
-}
\ No newline at end of file
+    if (json)
+        cout << "]}\n";
+}
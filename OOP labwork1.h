@@ -8,39 +8,145 @@
 #include <string>
 #include <numeric>
 #include <iomanip>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdio>
+#include <cerrno>
+#include <stdexcept>
+#include <limits>
+#include <type_traits>
 using namespace std;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define RNG_KERNELS_X86 1
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#define RNG_POSIX_IO 1
+#endif
 typedef unsigned long long ull;
 typedef long long ll;
 typedef long double ld;
-static map<vector<long double>, vector<long double>> intervals_uniform;
-static map<vector<long double>, vector<long double>> intervals_normal;
-static map<vector<long double>, vector<long double>> intervals_other9;
-static map<vector<long double>, vector<long double>> intervals_other10;
-ld first_rng(int repeat = 0, bool sum = false , bool floating = false);
-ld second_rng(int repeat = 0, bool sum = false , bool floating = false);
-ld third_rng(int repeat = 0, bool sum = false , bool floating = false);
-ld fourth_rng(int repeat = 0, bool sum = false , bool floating = false);
-ld fifth_rng(int repeat = 0, bool sum = false, int offset = 0);
+
+// Equal-width bins over [lo, hi] with one counter each. The bin of a sample is found by
+// arithmetic, (x - lo) * inv_width, and samples are counted rather than stored, so memory
+// stays at one ull per bin for any number of samples. Samples outside [lo, hi] are dropped;
+// x == hi falls into the last bin. The bin is computed in the type of the sample, so float
+// and double samples never go through long double arithmetic.
+class histogram {
+public:
+    histogram(double lo = 0, double hi = 1, size_t bins = 10)
+        : lo(lo), hi(hi), inv_width(bins / (hi - lo)), counts(bins, 0) {}
+
+    template <class Real>
+    void add(Real x) {
+        if (!(x >= Real(lo) && x <= Real(hi)))
+            return;
+        size_t bin = size_t((x - Real(lo)) * Real(inv_width));
+        ++counts[bin < counts.size() ? bin : counts.size() - 1];
+    }
+
+    size_t bins() const { return counts.size(); }
+    ull count(size_t bin) const { return counts[bin]; }
+
+    void clear() { fill(counts.begin(), counts.end(), 0); }
+
+    // Adds the counts of a histogram with the same bins
+    histogram& operator+=(const histogram& other) {
+        for (size_t i = 0; i < counts.size(); i++)
+            counts[i] += other.counts[i];
+        return *this;
+    }
+    double lower(size_t bin) const { return lo + bin * (hi - lo) / counts.size(); }
+    double upper(size_t bin) const { return lo + (bin + 1) * (hi - lo) / counts.size(); }
+
+private:
+    double lo, hi, inv_width;
+    vector<ull> counts;
+};
+
+inline histogram intervals_uniform;
+inline histogram intervals_normal;
+inline histogram intervals_other9;
+inline histogram intervals_other10;
+
+// Samples per generator run and worker threads, set from the command line
+inline ull sample_count = 100000;
+inline unsigned thread_count = max(1u, thread::hardware_concurrency());
+
+// Floating type of the samples, also set from the command line: float and double vectorize
+// and take 4 and 8 bytes a sample; long double is the slow, accurate x87 path
+enum precision_mode { single_precision, double_precision, extended_precision };
+inline precision_mode precision = double_precision;
+void first_rng();
+void second_rng();
+void third_rng();
+void fourth_rng();
+void fifth_rng();
 void sixth_rng();
 void seventh_rng();
 void eighth_rng();
 void nineth_rng();
 void tenth_rng();
+void eleventh_rng();
+void twelfth_rng();
+void compare_normal();
+void compare_gamma();
+void test_rng();
+void raw_rng(int g, int bits, ull count, const string& path);
+void bench_rng(ull n, size_t bins, bool json);
 void show_gist(vector<unsigned int>, const ld height);
 void declare_intervals(ld num_of_inters = 10);
-void show_interval_frequency(map<vector<long double>, vector<long double>> intervals, const ld height);
-void show(const map<vector<ld>, vector<ld>> interval_num);
+void show_interval_frequency(const histogram& intervals, const ld height);
+void show(const histogram& interval_num);
 ull modInverse(ull A, ll M);
+ull mul_mod(ull a, ull b, ull m);
 ull nearest_prime(ull n);
 bool is_prime(ull n);
+precision_mode parse_precision(const string& name);
 
 void declare_intervals(ld num_of_inters) {
-    for (ld i = 0; i < num_of_inters; i++)
-    {
-        intervals_uniform[{i / num_of_inters, 1.0 / num_of_inters + i / num_of_inters}] = { };
-        intervals_normal[{-3.0 + i * 6.0 / num_of_inters, -3.0 + 6.0 / num_of_inters + i * 6.0 / num_of_inters}] = {};
-        intervals_other9[{i * 3.0 / num_of_inters, 3.0 / num_of_inters + i * 3.0 / num_of_inters}] = { };
-        intervals_other10[{i * 10.0 / num_of_inters, 10.0 / num_of_inters + i * 10.0 / num_of_inters}] = { };
+    if (!(num_of_inters >= 1))
+        throw invalid_argument("the number of intervals must be at least 1");
+    size_t bins = size_t(num_of_inters);
+    intervals_uniform = histogram(0, 1, bins);
+    intervals_normal = histogram(-3, 3, bins);
+    intervals_other9 = histogram(0, 3, bins);
+    intervals_other10 = histogram(0, 40, bins);
+}
+
+precision_mode parse_precision(const string& name) {
+    if (name == "float")
+        return single_precision;
+    if (name == "double")
+        return double_precision;
+    if (name == "long")
+        return extended_precision;
+    throw invalid_argument("precision must be float, double or long, not " + name);
+}
+
+// Calls body(Real()) with Real the type chosen by precision, so a driver written once as a
+// generic lambda runs in float, double or long double
+template <class Body>
+void with_precision(Body body) {
+    switch (precision) {
+    case single_precision:
+        body(float());
+        break;
+    case double_precision:
+        body(double());
+        break;
+    case extended_precision:
+        body(ld());
+        break;
     }
 }
 
@@ -92,23 +198,1154 @@ ull modInverse(ull A, ll M)
     return x;
 }
 
-void show(const map<vector<ld>, vector<ld>> interval_num) {
-    vector<ld> sizes(interval_num.size());
-    unsigned int s = 0;
-    for (const auto& pair : interval_num) {
-        ld p = pair.second.size();
-        p = p / 100;
+// a * b mod m for a, b < m < 2^36 without overflow: b is split into 18-bit halves
+ull mul_mod(ull a, ull b, ull m)
+{
+    return ((a * (b >> 18) % m << 18) + a * (b & 0x3FFFF)) % m;
+}
+
+// For a step function on the states [0, m), the number of steps that lands where k steps
+// from x would: the orbit of x is a tail of mu states followed by a cycle of lambda, found
+// with Brent's algorithm, so any k past the tail reduces modulo lambda
+template <class Step>
+ull orbit_steps(ull x, ull k, ull m, Step step) {
+    if (k <= 2 * m)
+        return k;
+
+    ull power = 1, lambda = 1, tortoise = x, hare = step(x);
+    while (tortoise != hare) {
+        if (power == lambda) {
+            tortoise = hare;
+            power *= 2;
+            lambda = 0;
+        }
+        hare = step(hare);
+        lambda++;
+    }
+
+    ull mu = 0;
+    tortoise = hare = x;
+    for (ull i = 0; i < lambda; i++)
+        hare = step(hare);
+    while (tortoise != hare) {
+        tortoise = step(tortoise);
+        hare = step(hare);
+        mu++;
+    }
+    return k < mu ? k : mu + (k - mu) % lambda;
+}
+
+// Number of significant bits in v
+constexpr int bit_width(ull v) {
+    return v ? 1 + bit_width(v >> 1) : 0;
+}
+
+// The largest Real below 1. A value close to 1 can round up to 1 in a narrow type, so the
+// conversions to [0, 1) clamp to it.
+template <class Real>
+constexpr Real below_one = 1 - numeric_limits<Real>::epsilon() / 2;
+
+// The type a value is scaled to [0, 1) in before it becomes a Real. float goes through double,
+// as in the vector kernels, so every path rounds a value to the same float.
+template <class Real>
+using unit_scale = conditional_t<is_same_v<Real, float>, double, Real>;
+
+template <class Real>
+Real to_unit(ull v, unit_scale<Real> scale) {
+    return min(Real(unit_scale<Real>(v) * scale), below_one<Real>);
+}
+
+// Batch output shared by the engines: n successive values, as floating point in [0, 1) or as
+// the top 32 bits of each value (the whole value when it is narrower)
+template <class Engine, class Real>
+void fill_scalar(Engine& engine, Real* out, size_t n) {
+    const unit_scale<Real> scale = 1 / (unit_scale<Real>(Engine::max() - Engine::min()) + 1);
+    for (size_t i = 0; i < n; i++)
+        out[i] = to_unit<Real>(engine() - Engine::min(), scale);
+}
+
+template <class Engine>
+void fill_scalar(Engine& engine, uint32_t* out, size_t n) {
+    constexpr int shift = max(0, bit_width(Engine::max() - Engine::min()) - 32);
+    for (size_t i = 0; i < n; i++)
+        out[i] = uint32_t((engine() - Engine::min()) >> shift);
+}
+
+#ifdef RNG_KERNELS_X86
+inline bool has_avx2() {
+    static const bool supported = (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+    return supported;
+}
+#endif
+
+// The uniform generators as engines satisfying UniformRandomBitGenerator. Each one keeps its
+// state between calls, so the next value costs one step instead of a replay from the seed.
+
+// first_rng: linear congruential, x' = (a x + c) mod m
+class lcg_engine {
+public:
+    typedef ull result_type;
+    static constexpr ull m = 68719476731, a = 74, c = 75;
+
+    explicit lcg_engine(ull seed = 1) : x(seed % m) {}
+
+    // y mod m for y < 2^42 without a division: m = 2^36 - 5, so the bits above 36 fold back
+    // in times 5
+    static ull reduce(ull y) {
+        y = (y & low36) + 5 * (y >> 36);
+        return y >= m ? y - m : y;
+    }
+
+    ull next() {
+        x = reduce(a * x + c);
+        return x;
+    }
+
+    // The affine map x -> mul x + add of k steps, squaring the single step per bit of k
+    static void step_map(ull k, ull& mul, ull& add) {
+        ull square_mul = a, square_add = c;
+        mul = 1, add = 0;
+        for (; k; k >>= 1) {
+            if (k & 1) {
+                mul = mul_mod(square_mul, mul, m);
+                add = (mul_mod(square_mul, add, m) + square_add) % m;
+            }
+            square_add = (mul_mod(square_mul, square_add, m) + square_add) % m;
+            square_mul = mul_mod(square_mul, square_mul, m);
+        }
+    }
+
+    // Skip k values in O(log k)
+    void discard(ull k) {
+        ull mul, add;
+        step_map(k, mul, add);
+        x = (mul_mod(mul, x, m) + add) % m;
+    }
+
+    // n successive values, exactly as n calls to next() would give them, from interleaved
+    // lanes so the steps do not wait on each other. With AVX2, lane j of 16 (four registers)
+    // holds the values at positions j mod 16 and all lanes advance by the 16-step map at
+    // once; otherwise, and for long double, lane j of 8 produces the j-th eighth of the
+    // buffer one step at a time.
+    template <class T>
+    void fill(T* out, size_t n) { fill_lanes(out, n); }
+
+    ull operator()() { return next(); }
+    static constexpr ull min() { return 0; }
+    static constexpr ull max() { return m - 1; }
+
+private:
+    static constexpr ull low18 = (1ull << 18) - 1, low36 = (1ull << 36) - 1;
+    ull x;
+
+    // The same conversions as fill_scalar
+    template <class Real>
+    static void store(Real& out, ull v) { out = to_unit<Real>(v, unit_scale<Real>(1) / m); }
+    static void store(uint32_t& out, ull v) { out = uint32_t(v >> 4); }
+
+    template <class T>
+    void fill_lanes(T* out, size_t n) {
+        size_t done = 0;
+#ifdef RNG_KERNELS_X86
+        if constexpr (!is_same_v<T, ld>) {
+            if (has_avx2())
+                done = fill_avx2(x, out, n);
+        }
+        if (!done)
+#endif
+            done = fill_blocks(x, out, n);
+        discard(done);
+        fill_scalar(*this, out + done, n - done);
+    }
+
+    template <class T>
+    static size_t fill_blocks(ull x, T* out, size_t n) {
+        const size_t chunk = n / 8;
+        ull lanes[8];
+        for (size_t j = 0; j < 8; j++) {
+            lcg_engine lane(x);
+            lane.discard(j * chunk);
+            lanes[j] = lane.x;
+        }
+        for (size_t i = 0; i < chunk; i++) {
+            for (size_t j = 0; j < 8; j++) {
+                lanes[j] = reduce(a * lanes[j] + c);
+                store(out[j * chunk + i], lanes[j]);
+            }
+        }
+        return 8 * chunk;
+    }
+
+#ifdef RNG_KERNELS_X86
+    // mul * v + add mod m in four 64-bit lanes for mul, v < 2^36: both split into 18-bit
+    // halves so every partial product is a 32 x 32 bit multiply, and 2^36 = 5 (mod m) folds
+    // the high parts back
+    __attribute__((target("avx2")))
+    static __m256i step_lanes(__m256i v, __m256i mul_low, __m256i mul_high, __m256i add) {
+        const __m256i mask18 = _mm256_set1_epi64x(low18), mask36 = _mm256_set1_epi64x(low36);
+        __m256i v_low = _mm256_and_si256(v, mask18), v_high = _mm256_srli_epi64(v, 18);
+        __m256i p0 = _mm256_mul_epu32(mul_low, v_low);
+        __m256i p1 = _mm256_add_epi64(_mm256_mul_epu32(mul_low, v_high), _mm256_mul_epu32(mul_high, v_low));
+        __m256i p2 = _mm256_mul_epu32(mul_high, v_high);
+
+        // p2 2^36 + p1 2^18 + p0 = 5 (p2 + p1 / 2^18) + (p1 mod 2^18) 2^18 + p0, below 2^39
+        __m256i high = _mm256_add_epi64(p2, _mm256_srli_epi64(p1, 18));
+        __m256i y = _mm256_add_epi64(_mm256_add_epi64(high, _mm256_slli_epi64(high, 2)),
+                                     _mm256_slli_epi64(_mm256_and_si256(p1, mask18), 18));
+        y = _mm256_add_epi64(y, _mm256_add_epi64(p0, add));
+
+        high = _mm256_srli_epi64(y, 36);
+        y = _mm256_add_epi64(_mm256_and_si256(y, mask36), _mm256_add_epi64(high, _mm256_slli_epi64(high, 2)));
+        __m256i over = _mm256_cmpgt_epi64(y, _mm256_set1_epi64x(m - 1));
+        return _mm256_sub_epi64(y, _mm256_and_si256(over, _mm256_set1_epi64x(m)));
+    }
+
+    // v / m in double. Values below 2^52 convert exactly by planting them in the mantissa of
+    // 2^52.
+    __attribute__((target("avx2")))
+    static __m256d unit_lanes(__m256i v) {
+        const __m256i magic = _mm256_set1_epi64x(0x4330000000000000);
+        __m256d d = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(v, magic)), _mm256_castsi256_pd(magic));
+        return _mm256_mul_pd(d, _mm256_set1_pd(1.0 / m));
+    }
+
+    __attribute__((target("avx2")))
+    static void store_lanes(double* out, __m256i v) {
+        _mm256_storeu_pd(out, unit_lanes(v));
+    }
+
+    // Rounded to double and then to float, as to_unit does
+    __attribute__((target("avx2")))
+    static void store_lanes(float* out, __m256i v) {
+        __m128 f = _mm256_cvtpd_ps(unit_lanes(v));
+        _mm_storeu_ps(out, _mm_min_ps(f, _mm_set1_ps(below_one<float>)));
+    }
+
+    __attribute__((target("avx2")))
+    static void store_lanes(uint32_t* out, __m256i v) {
+        __m256i packed = _mm256_shuffle_epi32(_mm256_srli_epi64(v, 4), _MM_SHUFFLE(2, 0, 2, 0));
+        packed = _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm256_castsi256_si128(packed));
+    }
+
+    template <class T>
+    __attribute__((target("avx2")))
+    static size_t fill_avx2(ull x, T* out, size_t n) {
+        ull mul, add;
+        step_map(16, mul, add);
+        ull start[16];
+        for (size_t j = 0; j < 16; j++)
+            start[j] = x = reduce(a * x + c);
+
+        __m256i lanes[4];
+        for (size_t k = 0; k < 4; k++)
+            lanes[k] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(start + 4 * k));
+        const __m256i mul_low = _mm256_set1_epi64x(mul & low18), mul_high = _mm256_set1_epi64x(mul >> 18);
+        const __m256i add_lanes = _mm256_set1_epi64x(add);
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            for (size_t k = 0; k < 4; k++)
+                store_lanes(out + i + 4 * k, lanes[k]);
+            for (size_t k = 0; k < 4; k++)
+                lanes[k] = step_lanes(lanes[k], mul_low, mul_high, add_lanes);
+        }
+        return i;
+    }
+#endif
+};
+
+// second_rng: quadratic congruential, x' = (d x^2 + a x + c) mod m
+class quadratic_engine {
+public:
+    typedef ull result_type;
+    static constexpr ull m = 2097143, d = 8, a = 2097144, c = 49;
+
+    explicit quadratic_engine(ull seed = 1) : x(seed % m) {}
+
+    static ull step(ull x) { return (d * x * x + a * x + c) % m; }
+
+    ull next() {
+        x = step(x);
+        return x;
+    }
+
+    // The step is not linear, so values are skipped one by one, but never more than the
+    // tail and cycle of the orbit: at most a few m steps
+    void discard(ull k) {
+        for (k = orbit_steps(x, k, m, step); k; k--)
+            next();
+    }
+
+    template <class T>
+    void fill(T* out, size_t n) { fill_scalar(*this, out, n); }
+
+    ull operator()() { return next(); }
+    static constexpr ull min() { return 0; }
+    static constexpr ull max() { return m - 1; }
+
+private:
+    ull x;
+};
+
+// third_rng: Fibonacci, x' = (x_{n-1} + x_n) mod m
+class fibonacci_engine {
+public:
+    typedef ull result_type;
+    static constexpr ull m = 131071;
+
+    explicit fibonacci_engine(ull seed0 = 1, ull seed1 = 2) : x0(seed0 % m), x1(seed1 % m) {}
+
+    ull next() {
+        ull x = x0 + x1;
+        x = x >= m ? x - m : x;
+        x0 = x1;
+        x1 = x;
+        return x;
+    }
+
+    // Skip k values in O(log k) by powering the step matrix [[0, 1], [1, 1]]; m < 2^17 keeps
+    // every product in range
+    void discard(ull k) {
+        ull p = 0, q = 1, r = 1, s = 1;
+        for (; k; k >>= 1) {
+            if (k & 1) {
+                ull y0 = (p * x0 + q * x1) % m;
+                x1 = (r * x0 + s * x1) % m;
+                x0 = y0;
+            }
+            ull p2 = (p * p + q * r) % m, q2 = (p * q + q * s) % m;
+            ull r2 = (r * p + s * r) % m, s2 = (r * q + s * s) % m;
+            p = p2, q = q2, r = r2, s = s2;
+        }
+    }
+
+    template <class T>
+    void fill(T* out, size_t n) { fill_scalar(*this, out, n); }
+
+    ull operator()() { return next(); }
+    static constexpr ull min() { return 0; }
+    static constexpr ull max() { return m - 1; }
+
+private:
+    ull x0, x1;
+};
+
+// fourth_rng: inverse congruential, x' = (a x^-1 + c) mod m with 0^-1 taken as 0. The
+// modulus is small enough to tabulate the step once instead of running an extended Euclid,
+// with its divisions, per value. Inversion and the affine map are both bijections, so the
+// step is a permutation of [0, m) and the states fall into cycles; the tables also list each
+// cycle in step order, so the values after x are consecutive entries of one array.
+class inverse_engine {
+public:
+    typedef ull result_type;
+    static constexpr ull m = 16381, a = 101, c = 103;
+
+    explicit inverse_engine(ull seed = 1) : x(seed % m) {}
+
+    static ull step(ull x) { return get_tables().step[x]; }
+
+    ull next() {
+        x = step(x);
+        return x;
+    }
+
+    // Skip k values in O(1): k steps along the cycle of x
+    void discard(ull k) {
+        const tables& t = get_tables();
+        ull length = t.length[x], offset = t.position[x] - t.start[x];
+        x = t.order[t.start[x] + (offset + k % length) % length];
+    }
+
+    // n successive values, converted as fill_scalar does, from runs of the cycle of x
+    template <class T>
+    void fill(T* out, size_t n) {
+        const tables& t = get_tables();
+        const uint16_t* cycle = t.order.data() + t.start[x];
+        size_t length = t.length[x], p = t.position[x] - t.start[x];
+        for (size_t i = 0; i < n;) {
+            p = p + 1 < length ? p + 1 : 0;
+            size_t run = std::min(n - i, length - p);
+            for (size_t j = 0; j < run; j++)
+                store(out[i + j], cycle[p + j]);
+            i += run;
+            p += run - 1;
+        }
+        x = cycle[p];
+    }
+
+    ull operator()() { return next(); }
+    static constexpr ull min() { return 0; }
+    static constexpr ull max() { return m - 1; }
+
+private:
+    ull x;
+
+    template <class Real>
+    static void store(Real& out, ull v) { out = to_unit<Real>(v, 1 / unit_scale<Real>(m)); }
+    static void store(uint32_t& out, ull v) { out = uint32_t(v); }
+
+    // step: the step of each state; order: the states cycle by cycle; for each state x,
+    // position: its index in order, start and length: where its cycle begins and how long
+    // it is. 160 KB in all.
+    struct tables {
+        vector<uint16_t> step, order, position, start, length;
+    };
+
+    static const tables& get_tables() {
+        static const tables t = build();
+        return t;
+    }
+
+    static tables build() {
+        tables t;
+        t.step.resize(m);
+        for (ull v = 0; v < m; v++)
+            t.step[v] = uint16_t((a * (v == 0 ? 0 : modInverse(v, m)) + c) % m);
+        t.position.assign(m, m);
+        t.start.resize(m);
+        t.length.resize(m);
+        for (ull v = 0; v < m; v++) {
+            if (t.position[v] != m)
+                continue;
+            size_t first = t.order.size();
+            for (ull u = v; t.position[u] == m; u = t.step[u]) {
+                t.position[u] = uint16_t(t.order.size());
+                t.order.push_back(uint16_t(u));
+            }
+            for (size_t i = first; i < t.order.size(); i++) {
+                t.start[t.order[i]] = uint16_t(first);
+                t.length[t.order[i]] = uint16_t(t.order.size() - first);
+            }
+        }
+        return t;
+    }
+};
+
+// fifth_rng: difference of the first two generators, x = (x_lcg - x_quadratic) mod m_lcg
+class difference_engine {
+public:
+    typedef ull result_type;
+    static constexpr ull m = lcg_engine::m;
+
+    explicit difference_engine(ull seed1 = 1, ull seed2 = 1) : first(seed1), second(seed2) {}
+
+    ull next() {
+        ull x = first();
+        return (x + m - second()) % m;
+    }
+
+    void discard(ull k) {
+        first.discard(k);
+        second.discard(k);
+    }
+
+    template <class T>
+    void fill(T* out, size_t n) { fill_scalar(*this, out, n); }
+
+    ull operator()() { return next(); }
+    static constexpr ull min() { return 0; }
+    static constexpr ull max() { return m - 1; }
+
+private:
+    lcg_engine first;
+    quadratic_engine second;
+};
+
+// An engine that counts the values drawn from it in values_drawn, for measuring how many
+// values a transform takes per sample; plain_engine leaves the engine as it is
+inline ull values_drawn = 0;
+
+template <class Engine>
+class counting_engine : public Engine {
+public:
+    typename Engine::result_type operator()() {
+        values_drawn++;
+        return Engine::operator()();
+    }
+
+    template <class T>
+    void fill(T* out, size_t n) {
+        values_drawn += n;
+        Engine::fill(out, n);
+    }
+};
+
+template <class Engine>
+using plain_engine = Engine;
+
+// n copies of engine over consecutive blocks of its sequence: copy i starts i * length values
+// in, so worker i sees exactly the values one engine would produce for positions
+// i * length .. (i + 1) * length - 1, whatever n is
+template <class Engine>
+vector<Engine> split(const Engine& engine, size_t n, ull length) {
+    vector<Engine> streams(n, engine);
+    for (size_t i = 1; i < n; i++) {
+        streams[i] = streams[i - 1];
+        streams[i].discard(length);
+    }
+    return streams;
+}
+
+// Runs sample(first, count, out) for the samples 0 .. sample_count - 1, one contiguous range
+// per worker thread, each filling a private copy of intervals for locality and no
+// contention; the copies are added into intervals at the end. A sampler that positions its
+// engines with discard() at sample first gives the same counts for any thread count. Ranges
+// start at multiples of granularity, for samplers that position their engines per block.
+template <class Sampler>
+void run_parallel(histogram& intervals, Sampler sample, ull granularity = 1) {
+    vector<histogram> parts(thread_count, intervals);
+    vector<thread> workers;
+    for (unsigned t = 0; t < thread_count; t++) {
+        ull first = sample_count * t / thread_count / granularity * granularity;
+        ull last = t + 1 == thread_count ? sample_count : sample_count * (t + 1) / thread_count / granularity * granularity;
+        parts[t].clear();
+        workers.emplace_back([&sample, &parts, t, first, last] { sample(first, last - first, parts[t]); });
+    }
+    for (auto& worker : workers)
+        worker.join();
+    for (const auto& part : parts)
+        intervals += part;
+}
+
+// Next value of an engine scaled to [0, 1) in the type Real, x / m for the modular generators
+template <class Real, class Engine>
+Real uniform(Engine& engine) {
+    constexpr unit_scale<Real> scale = 1 / (unit_scale<Real>(Engine::max() - Engine::min()) + 1);
+    return to_unit<Real>(engine() - Engine::min(), scale);
+}
+
+// 32 random bits: the top 32 bits of one value, or narrower values packed together
+template <class Engine>
+uint32_t random_word(Engine& engine) {
+    constexpr int width = bit_width(Engine::max() - Engine::min());
+    if constexpr (width >= 32) {
+        return uint32_t((engine() - Engine::min()) >> (width - 32));
+    } else {
+        ull word = 0;
+        for (int have = 0; have < 32; have += width)
+            word = (word << width) | (engine() - Engine::min());
+        return uint32_t(word);
+    }
+}
+
+// A uniform in (0, 1) from one word, safe to take the logarithm of
+template <class Engine>
+double open_uniform(Engine& engine) {
+    return (random_word(engine) + 0.5) * (1.0 / 4294967296.0);
+}
+
+// The per-sample transforms of sixth_rng, seventh_rng and eighth_rng, computed in the type
+// Real of their result
+
+// Sum of 12 uniforms, centred: mean 0, variance 1
+template <class Real, class Engine>
+Real sum12_normal(Engine& engine) {
+    Real sum = 0;
+    for (int k = 0; k < 12; k++)
+        sum += uniform<Real>(engine);
+    return sum - 6;
+}
+
+// Marsaglia's polar method: a pair of normals from a point in the unit disc, false when the
+// point falls outside it
+template <class Engine1, class Engine2, class Real>
+bool polar_normal(Engine1& first, Engine2& second, Real& x1, Real& x2) {
+    Real v1 = 2 * uniform<Real>(first) - 1;
+    Real v2 = 2 * uniform<Real>(second) - 1;
+    Real s = v1 * v1 + v2 * v2;
+    if (s >= 1)
+        return false;
+    x1 = v1 * sqrt(-2 * log(s) / s);
+    x2 = v2 * sqrt(-2 * log(s) / s);
+    return true;
+}
+
+// Ratio of uniforms with the quick acceptance and rejection bounds, false when rejected
+template <class Engine1, class Engine2, class Real>
+bool ratio_normal(Engine1& third, Engine2& fourth, Real& x) {
+    Real u = uniform<Real>(third);
+    Real v = uniform<Real>(fourth);
+    x = Real(sqrt(8 / M_E)) * ((v - Real(0.5)) / u);
+    return ((x * x) <= 5 - Real(4 * exp(0.25)) * u) && (x * x) < ((Real(4 * exp(-1.35)) / u) + Real(1.4))
+        && ((x * x) <= -4 * log(u));
+}
+
+// The transform of the old tenth_rng: Gamma(a) by rejection from a Cauchy proposal centred
+// on a - 1, false when rejected
+template <class Engine1, class Engine2, class Real>
+bool cauchy_gamma(Engine1& first, Engine2& second, int a, Real& x) {
+    Real u = uniform<Real>(first);
+    Real v = uniform<Real>(second);
+    Real y = tan(Real(M_PI) * u);
+    x = sqrt(Real(2 * a - 1)) * y + a - 1;
+    return x > 0 && v <= ((1 + y * y) * exp((a - 1) * log(x / (a - 1)) - sqrt(Real(2 * a - 1)) * y));
+}
+
+// Marsaglia and Tsang's Ziggurat for the standard normal. The density is covered by 128
+// layers of equal area; a 32-bit word picks a layer (low 7 bits) and a signed point across
+// it (the whole word). About 99% of points lie inside the layer's rectangle under the next
+// one up and return after one table lookup and one multiply; the rest test the wedge
+// against the density or, in the base layer, sample the tail beyond r. The tables and the
+// arithmetic are in Real; the tables are built in double whatever Real is.
+template <class Real = double>
+class ziggurat_normal {
+public:
+    template <class Engine>
+    Real operator()(Engine& engine) {
+        const tables& t = get_tables();
+        for (;;) {
+            int32_t word = int32_t(random_word(engine));
+            size_t layer = word & 127;
+            Real x = word * t.w[layer];
+            if (ull(word < 0 ? -ll(word) : word) < t.k[layer])
+                return x;
+
+            if (layer == 0) {
+                Real tail, y;
+                do {
+                    tail = -log(Real(open_uniform(engine))) / Real(r);
+                    y = -log(Real(open_uniform(engine)));
+                } while (y + y < tail * tail);
+                return word > 0 ? Real(r) + tail : -Real(r) - tail;
+            }
+            if (t.f[layer] + Real(open_uniform(engine)) * (t.f[layer - 1] - t.f[layer]) < exp(-Real(0.5) * x * x))
+                return x;
+        }
+    }
+
+private:
+    static constexpr double r = 3.442619855899, area = 9.91256303526217e-3, scale = 2147483648.0;
+
+    // k: the rectangle bound scaled to the word, w: word to x, f: density at each layer edge
+    struct tables {
+        ull k[128];
+        Real w[128], f[128];
+    };
+
+    static const tables& get_tables() {
+        static const tables t = build();
+        return t;
+    }
+
+    static tables build() {
+        tables t;
+        double edge = r, previous = r, q = area / exp(-0.5 * r * r);
+        t.k[0] = ull(r / q * scale);
+        t.k[1] = 0;
+        t.w[0] = q / scale;
+        t.w[127] = r / scale;
+        t.f[0] = 1;
+        t.f[127] = exp(-0.5 * r * r);
+        for (int i = 126; i >= 1; i--) {
+            edge = sqrt(-2 * log(area / edge + exp(-0.5 * edge * edge)));
+            t.k[i + 1] = ull(edge / previous * scale);
+            previous = edge;
+            t.f[i] = exp(-0.5 * edge * edge);
+            t.w[i] = edge / scale;
+        }
+        return t;
+    }
+};
+
+// The same construction for the unit exponential: 256 layers, an unsigned word, and a tail
+// beyond r that is again exponential, so it is r plus a fresh -log(u)
+template <class Real = double>
+class ziggurat_exponential {
+public:
+    template <class Engine>
+    Real operator()(Engine& engine) {
+        const tables& t = get_tables();
+        for (;;) {
+            uint32_t word = random_word(engine);
+            size_t layer = word & 255;
+            Real x = word * t.w[layer];
+            if (word < t.k[layer])
+                return x;
+
+            if (layer == 0)
+                return Real(r) - log(Real(open_uniform(engine)));
+            if (t.f[layer] + Real(open_uniform(engine)) * (t.f[layer - 1] - t.f[layer]) < exp(-x))
+                return x;
+        }
+    }
+
+private:
+    static constexpr double r = 7.697117470131487, area = 3.949659822581572e-3, scale = 4294967296.0;
+
+    struct tables {
+        ull k[256];
+        Real w[256], f[256];
+    };
+
+    static const tables& get_tables() {
+        static const tables t = build();
+        return t;
+    }
+
+    static tables build() {
+        tables t;
+        double edge = r, previous = r, q = area / exp(-r);
+        t.k[0] = ull(r / q * scale);
+        t.k[1] = 0;
+        t.w[0] = q / scale;
+        t.w[255] = r / scale;
+        t.f[0] = 1;
+        t.f[255] = exp(-r);
+        for (int i = 254; i >= 1; i--) {
+            edge = -log(area / edge + exp(-edge));
+            t.k[i + 1] = ull(edge / previous * scale);
+            previous = edge;
+            t.f[i] = exp(-edge);
+            t.w[i] = edge / scale;
+        }
+        return t;
+    }
+};
+
+// Marsaglia and Tsang's gamma sampler for any shape a, scale 1: d (1 + c x)^3 for a standard
+// normal x, with d = a - 1/3 and c = 1 / sqrt(9 d), accepted about 98% of the time and
+// mostly by a squeeze that needs no logarithm. Shapes below 1 sample a + 1 and scale by
+// u^(1/a).
+template <class Real = double>
+class gamma_sampler {
+public:
+    explicit gamma_sampler(Real shape)
+        : shape(shape), d((shape < 1 ? shape + 1 : shape) - Real(1) / 3), c(1 / sqrt(9 * d)) {}
+
+    template <class Engine>
+    Real operator()(Engine& engine) {
+        for (;;) {
+            Real x = normal(engine), v = 1 + c * x;
+            if (v <= 0)
+                continue;
+            v = v * v * v;
+            Real u = Real(open_uniform(engine)), x2 = x * x;
+            if (u < 1 - Real(0.0331) * x2 * x2 || log(u) < Real(0.5) * x2 + d * (1 - v + log(v)))
+                return shape < 1 ? d * v * pow(Real(open_uniform(engine)), 1 / shape) : d * v;
+        }
+    }
+
+    Real get_shape() const { return shape; }
+
+private:
+    Real shape, d, c;
+    ziggurat_normal<Real> normal;
+};
+
+// The regularized incomplete gamma functions P(a, x) and Q(a, x) = 1 - P(a, x): the series
+// for P converges fast below x = a + 1, the continued fraction for Q (Lentz's method) above
+inline ld gamma_series(ld a, ld x) {
+    ld term = 1 / a, sum = term;
+    for (int n = 1; n < 10000 && fabsl(term) > fabsl(sum) * 1e-19L; n++) {
+        term *= x / (a + n);
+        sum += term;
+    }
+    return sum * expl(a * logl(x) - x - lgammal(a));
+}
+
+inline ld gamma_fraction(ld a, ld x) {
+    const ld tiny = 1e-300L;
+    ld b = x + 1 - a, c = 1 / tiny, d = 1 / b, h = d;
+    for (int i = 1; i < 10000; i++) {
+        ld an = -i * (i - a);
+        b += 2;
+        d = an * d + b;
+        d = fabsl(d) < tiny ? tiny : d;
+        c = b + an / c;
+        c = fabsl(c) < tiny ? tiny : c;
+        d = 1 / d;
+        ld delta = d * c;
+        h *= delta;
+        if (fabsl(delta - 1) < 1e-19L)
+            break;
+    }
+    return h * expl(a * logl(x) - x - lgammal(a));
+}
+
+inline ld regularized_gamma_p(ld a, ld x) {
+    if (x <= 0)
+        return 0;
+    return x < a + 1 ? gamma_series(a, x) : 1 - gamma_fraction(a, x);
+}
+
+inline ld regularized_gamma_q(ld a, ld x) {
+    if (x <= 0)
+        return 1;
+    return x < a + 1 ? 1 - gamma_series(a, x) : gamma_fraction(a, x);
+}
+
+// Pearson's chi-square of a histogram against a distribution function cdf, for n samples in
+// total: one cell per bin plus one for everything outside the histogram's range, if at least
+// one sample is expected there. cells is set to the number of cells used, so the statistic has
+// cells - 1 degrees of freedom.
+template <class Cdf>
+ld chi_square(const histogram& intervals, ull n, Cdf cdf, size_t& cells) {
+    ld statistic = 0, inside = 0, expected_inside = 0;
+    for (size_t i = 0; i < intervals.bins(); i++) {
+        ld expected = n * (cdf(intervals.upper(i)) - cdf(intervals.lower(i)));
+        ld observed = intervals.count(i);
+        statistic += (observed - expected) * (observed - expected) / expected;
+        inside += observed;
+        expected_inside += expected;
+    }
+    ld expected_outside = n - expected_inside, observed_outside = n - inside;
+    cells = intervals.bins();
+    if (expected_outside >= 1) {
+        statistic += (observed_outside - expected_outside) * (observed_outside - expected_outside) / expected_outside;
+        cells++;
+    }
+    return statistic;
+}
+
+// Upper tail probability of a chi-square statistic with dof degrees of freedom
+inline ld chi_square_p(ld statistic, ld dof) {
+    return regularized_gamma_q(dof / 2, statistic / 2);
+}
+
+inline ld normal_cdf(ld x) {
+    return 0.5 * erfcl(-x / sqrtl(2));
+}
+
+// Kolmogorov's limiting distribution: the probability that sqrt(n) D exceeds lambda, from
+// whichever of its two series converges fast at lambda
+inline ld kolmogorov_p(ld lambda) {
+    if (lambda <= 0)
+        return 1;
+    ld sum = 0;
+    if (lambda < 1.18L) {
+        for (int k = 1; k <= 20; k++)
+            sum += expl(-(2 * k - 1) * (2 * k - 1) * M_PI * M_PI / (8 * lambda * lambda));
+        return 1 - sqrtl(2 * M_PI) / lambda * sum;
+    }
+    for (int k = 1; k <= 20; k++)
+        sum += (k % 2 ? 2 : -2) * expl(-2 * k * k * lambda * lambda);
+    return sum;
+}
+
+// Goodness-of-fit tests of a stream that should be independent draws from the distribution
+// cdf, updated batch by batch in memory that does not grow with the number of samples.
+// Samples are counted in resolution fine cells over [lo, hi] plus one cell on either side,
+// and each is replaced by u, the cdf at the middle of its cell, which is uniform on (0, 1)
+// whatever the distribution. The tests:
+//  - chi-square on `cells` groups of fine cells of about equal probability
+//  - Kolmogorov-Smirnov with the empirical distribution known at the fine cell edges only;
+//    the D found falls short of the exact one by at most the probability of one fine cell
+//  - serial correlation of u at lags 1 .. lags, sqrt(n) r being standard normal
+//  - gap test: lengths of the gaps between samples below the cell edge nearest the median
+//  - Knuth's runs-up test on the samples themselves, dropping the sample after each run so
+//    run lengths are independent
+class stream_tests {
+public:
+    stream_tests(double lo, double hi, function<ld(ld)> cdf, size_t cells = 10, size_t lags = 3,
+                 size_t resolution = 1 << 16)
+        : lo(lo), hi(hi), inv_width(resolution / (hi - lo)), resolution(resolution), cells(cells),
+          edge_cdf(resolution + 1), cell_u(resolution + 2), counts(resolution + 2, 0), lag_sums(lags, 0),
+          recent(lags, 0), gaps(gap_limit + 1, 0), runs(run_limit, 0) {
+        for (size_t j = 0; j <= resolution; j++)
+            edge_cdf[j] = cdf(lo + j * (hi - lo) / resolution);
+        cell_u[0] = double(edge_cdf[0] / 2);
+        for (size_t j = 0; j < resolution; j++)
+            cell_u[j + 1] = double((edge_cdf[j] + edge_cdf[j + 1]) / 2);
+        cell_u[resolution + 1] = double((1 + edge_cdf[resolution]) / 2);
+
+        // cell index c < split is the set of the gap test, of probability split_p
+        size_t edge = 0;
+        for (size_t j = 1; j <= resolution; j++)
+            if (fabsl(edge_cdf[j] - 0.5L) < fabsl(edge_cdf[edge] - 0.5L))
+                edge = j;
+        split = edge + 1;
+        split_p = edge_cdf[edge];
+    }
+
+    template <class Real>
+    void add(const Real* x, size_t n) {
+        scratch.resize(n);
+        double sum = 0, squares = 0;
+        for (size_t i = 0; i < n; i++) {
+            double v = double(x[i]);
+            size_t c = v < lo ? 0 : resolution + 1;
+            if (v >= lo && v <= hi) {
+                c = size_t((v - lo) * inv_width);
+                c = 1 + (c < resolution ? c : resolution - 1);
+            }
+            ++counts[c];
+            // Branch-free: whether a sample ends a gap or a run is a coin toss
+            bool hit = c < split;
+            gaps[gap < gap_limit ? gap : gap_limit] += hit;
+            gap = hit ? 0 : gap + 1;
+            double y = cell_u[c] - 0.5;
+            scratch[i] = y;
+            sum += y;
+            squares += y * y;
+        }
+        total_sum += sum;
+        total_squares += squares;
+
+        // Products y_t y_{t-k}, the first k of a batch pairing with the end of the last one
+        for (size_t k = 1; k <= lag_sums.size(); k++) {
+            double products = 0;
+            for (size_t i = 0; i < n && i < k; i++)
+                if (total + i >= k)
+                    products += scratch[i] * recent[recent.size() - k + i];
+            for (size_t i = k; i < n; i++)
+                products += scratch[i] * scratch[i - k];
+            lag_sums[k - 1] += products;
+        }
+        if (n >= recent.size()) {
+            copy(scratch.end() - recent.size(), scratch.end(), recent.begin());
+        } else {
+            rotate(recent.begin(), recent.begin() + n, recent.end());
+            copy(scratch.begin(), scratch.end(), recent.end() - n);
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            double v = double(x[i]);
+            bool up = in_run && v > run_last, end = in_run && !up;
+            runs[(run_length < run_limit ? run_length : run_limit) - 1] += end;
+            run_length = up ? run_length + 1 : 1;
+            in_run = !end;
+            run_last = v;
+        }
+        total += n;
+    }
+
+    ull size() const { return total; }
+
+    void report(ostream& out) const {
+        auto row = [&out](const string& name, ld statistic, ld dof, ld p) {
+            out << left << setw(28) << name << right << fixed << setprecision(4) << setw(14) << statistic;
+            if (dof > 0)
+                out << setw(6) << setprecision(0) << dof;
+            else
+                out << setw(6) << "-";
+            out << setw(12) << setprecision(4) << p << defaultfloat << setprecision(6) << "\n";
+        };
+        const ld n = total;
+        out << left << setw(28) << "test" << right << setw(14) << "statistic" << setw(6) << "dof" << setw(12)
+            << "p-value" << "\n";
+
+        vector<ld> expected(cells, 0), observed(cells, 0);
+        expected[0] += edge_cdf[0];
+        observed[0] += counts[0];
+        for (size_t j = 0; j < resolution; j++) {
+            size_t group = min(cells - 1, size_t((edge_cdf[j] + edge_cdf[j + 1]) / 2 * cells));
+            expected[group] += edge_cdf[j + 1] - edge_cdf[j];
+            observed[group] += counts[j + 1];
+        }
+        expected[cells - 1] += 1 - edge_cdf[resolution];
+        observed[cells - 1] += counts[resolution + 1];
+        ld chi = 0;
+        size_t used = 0;
+        for (size_t g = 0; g < cells; g++) {
+            if (expected[g] > 0) {
+                chi += (observed[g] - n * expected[g]) * (observed[g] - n * expected[g]) / (n * expected[g]);
+                used++;
+            }
+        }
+        row("chi-square, " + to_string(cells) + " cells", chi, used - 1, chi_square_p(chi, used - 1));
+
+        ull cumulative = counts[0];
+        ld d = fabsl(cumulative / n - edge_cdf[0]);
+        for (size_t j = 0; j < resolution; j++) {
+            cumulative += counts[j + 1];
+            d = max(d, fabsl(cumulative / n - edge_cdf[j + 1]));
+        }
+        ld root = sqrtl(n);
+        row("kolmogorov-smirnov", root * d, 0, kolmogorov_p((root + 0.12L + 0.11L / root) * d));
+
+        ld mean = total_sum / n, variance = total_squares / n - mean * mean;
+        for (size_t k = 1; k <= lag_sums.size(); k++) {
+            ld r = (lag_sums[k - 1] / (n - k) - mean * mean) / variance;
+            ld z = r * sqrtl(n - k);
+            row("serial correlation, lag " + to_string(k), z, 0, erfcl(fabsl(z) / sqrtl(2)));
+        }
+
+        // P(gap = r) = p (1 - p)^r below the limit, (1 - p)^limit at it
+        ld gap_count = accumulate(gaps.begin(), gaps.end(), 0.0L), gap_chi = 0, q = 1;
+        for (size_t r = 0; r <= gap_limit; r++) {
+            ld e = gap_count * (r < gap_limit ? split_p * q : q);
+            gap_chi += (gaps[r] - e) * (gaps[r] - e) / e;
+            q *= 1 - split_p;
+        }
+        row("gap", gap_chi, gap_limit, chi_square_p(gap_chi, gap_limit));
+
+        // P(run = r) = 1/r! - 1/(r+1)! below the limit, 1/limit! at it
+        ld run_count = accumulate(runs.begin(), runs.end(), 0.0L), run_chi = 0, factorial = 1;
+        for (size_t r = 1; r <= run_limit; r++) {
+            factorial *= r;
+            ld e = run_count * (r < run_limit ? 1 / factorial - 1 / (factorial * (r + 1)) : 1 / factorial);
+            run_chi += (runs[r - 1] - e) * (runs[r - 1] - e) / e;
+        }
+        row("runs up", run_chi, run_limit - 1, chi_square_p(run_chi, run_limit - 1));
+    }
+
+private:
+    static constexpr size_t gap_limit = 10, run_limit = 6;
+    double lo, hi, inv_width;
+    size_t resolution, cells, split;
+    ld split_p;
+    vector<ld> edge_cdf;
+    vector<double> cell_u;
+    vector<ull> counts;
+    ull total = 0;
+    ld total_sum = 0, total_squares = 0;
+    vector<ld> lag_sums;
+    vector<double> recent, scratch;
+    ull gap = 0;
+    vector<ull> gaps;
+    bool in_run = false;
+    double run_last = 0;
+    size_t run_length = 1;
+    vector<ull> runs;
+};
+
+// Hands batches from a producer to a consumer on a background thread through a fixed ring
+// of buffers: the producer fills one buffer while the consumer works through another and
+// waits only when every buffer is full, so memory stays at buffers * batch values.
+template <class Real>
+class batch_pipe {
+public:
+    explicit batch_pipe(function<void(const Real*, size_t)> consume, size_t buffers = 4, size_t batch = 1 << 16)
+        : consume(move(consume)), slots(buffers, vector<Real>(batch)), sizes(buffers), worker([this] { run(); }) {}
+
+    ~batch_pipe() { finish(); }
+
+    size_t batch_size() const { return slots[0].size(); }
+
+    // A free buffer of batch_size() values, waiting for the consumer if there is none
+    Real* acquire() {
+        unique_lock<mutex> lock(guard);
+        changed.wait(lock, [this] { return produced - consumed < slots.size(); });
+        return slots[produced % slots.size()].data();
+    }
+
+    // Passes the first n values of the buffer from acquire() to the consumer
+    void submit(size_t n) {
+        {
+            lock_guard<mutex> lock(guard);
+            sizes[produced % slots.size()] = n;
+            produced++;
+        }
+        changed.notify_all();
+    }
+
+    // Waits until every submitted batch is consumed and stops the thread
+    void finish() {
+        {
+            lock_guard<mutex> lock(guard);
+            closed = true;
+        }
+        changed.notify_all();
+        if (worker.joinable())
+            worker.join();
+    }
+
+    // Time the consumer spent on batches, valid after finish()
+    double busy_seconds() const { return busy; }
+
+private:
+    function<void(const Real*, size_t)> consume;
+    vector<vector<Real>> slots;
+    vector<size_t> sizes;
+    size_t produced = 0, consumed = 0;
+    bool closed = false;
+    double busy = 0;
+    mutex guard;
+    condition_variable changed;
+    thread worker;
+
+    void run() {
+        unique_lock<mutex> lock(guard);
+        for (;;) {
+            changed.wait(lock, [this] { return consumed < produced || closed; });
+            if (consumed == produced)
+                return;
+            size_t slot = consumed % slots.size();
+            lock.unlock();
+            auto start = chrono::steady_clock::now();
+            consume(slots[slot].data(), sizes[slot]);
+            busy += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            lock.lock();
+            consumed++;
+            changed.notify_all();
+        }
+    }
+};
+
+// A file, or stdout for "-", taking raw binary output in whole buffers: with POSIX write()
+// there is no stdio buffering or copying between the generator and the reader. write()
+// returns false once the output fails, e.g. when the reader at the other end of a pipe is
+// done: SIGPIPE is ignored, so that shows up as EPIPE instead of killing the process.
+class raw_output {
+public:
+    explicit raw_output(const string& path) {
+#ifdef RNG_POSIX_IO
+        signal(SIGPIPE, SIG_IGN);
+        fd = path == "-" ? STDOUT_FILENO : open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+            throw runtime_error("cannot open " + path);
+#else
+        file = path == "-" ? stdout : fopen(path.c_str(), "wb");
+        if (!file)
+            throw runtime_error("cannot open " + path);
+#endif
+    }
+
+    ~raw_output() {
+#ifdef RNG_POSIX_IO
+        if (fd != STDOUT_FILENO)
+            close(fd);
+#else
+        if (file != stdout)
+            fclose(file);
+        else
+            fflush(file);
+#endif
+    }
+
+    raw_output(const raw_output&) = delete;
+    raw_output& operator=(const raw_output&) = delete;
+
+    bool write(const void* data, size_t size) {
+        const char* bytes = static_cast<const char*>(data);
+#ifdef RNG_POSIX_IO
+        while (size > 0) {
+            ssize_t written = ::write(fd, bytes, size);
+            if (written < 0 && errno == EINTR)
+                continue;
+            if (written <= 0)
+                return false;
+            bytes += written;
+            size -= size_t(written);
+        }
+        return true;
+#else
+        return fwrite(bytes, 1, size, file) == size;
+#endif
+    }
+
+private:
+#ifdef RNG_POSIX_IO
+    int fd;
+#else
+    FILE* file;
+#endif
+};
+
+void show(const histogram& interval_num) {
+    vector<ld> sizes(interval_num.bins());
+    for (size_t s = 0; s < sizes.size(); s++) {
+        ld p = interval_num.count(s);
+        p = p * 1000 / sample_count;
         sizes[s]+= p;
-        s += 1;
     }
 
     int max_value = *max_element(sizes.begin(), sizes.end());
-    int k = 0;
     for (int i = max_value; i > 0; --i) {
        cout.width(2);
        cout << i << " | ";
 
-       for (int j = 0; j < interval_num.size(); ++j) {
+       for (size_t j = 0; j < sizes.size(); ++j) {
            if (sizes[j] >= i) {
                cout << "x ";
                sizes[j] -= 1;
@@ -122,10 +1359,10 @@ void show(const map<vector<ld>, vector<ld>> interval_num) {
     cout << "---------------------------------------" << endl << endl;
     }
 
-void show_interval_frequency(map<vector<long double>, vector<long double>> intervals, const ld height) {
-    for (const auto& pair : intervals) {
-        ld frequency = pair.second.size() / height;
-        cout << "[" << pair.first[0] << "," << pair.first[1] << "]" << setw(14) << frequency << "\n";
+void show_interval_frequency(const histogram& intervals, const ld height) {
+    for (size_t i = 0; i < intervals.bins(); i++) {
+        ld frequency = intervals.count(i) / height;
+        cout << "[" << intervals.lower(i) << "," << intervals.upper(i) << "]" << setw(14) << frequency << "\n";
     }
 }
 #endif
\ No newline at end of file
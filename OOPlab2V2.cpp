@@ -3,38 +3,1434 @@
 #include <vector>
 #include <algorithm>
 #include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <random>
+#include <memory>
+#include <map>
+#include <list>
+#include <unordered_map>
+#include <atomic>
+#include <deque>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <string_view>
+#include <charconv>
+#include <cmath>
+#include <numeric>
+#include <array>
+#include <utility>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define DIGIT_KERNELS_X86 1
+#endif
+
+// Low-level kernels over unsigned decimal digit strings (most significant digit first).
+// The BigInt and BigNat digit loops go through these; the fastest implementation for the
+// running CPU is picked once, on first use.
+namespace digitKernels {
+    // out[0..outLen) = a + b * 10^shift, where outLen = max(na, nb + shift) + 1
+    typedef void (*AddShiftedFn)(const char* a, size_t na, const char* b, size_t nb, size_t shift, char* out, size_t outLen);
+    // out[0..na) = a - b * 10^shift, requires a >= b * 10^shift
+    typedef void (*SubShiftedFn)(const char* a, size_t na, const char* b, size_t nb, size_t shift, char* out);
+    // Three-way comparison of two magnitudes without leading zeros
+    typedef int (*CompareFn)(const char* a, size_t na, const char* b, size_t nb);
+    // acc[0..nacc) += b * 10^shift, requires nacc >= nb + shift; a carry out of acc is dropped
+    typedef void (*AddInPlaceFn)(char* acc, size_t nacc, const char* b, size_t nb, size_t shift);
+
+    struct KernelTable {
+        const char* name;
+        AddShiftedFn addShifted;
+        SubShiftedFn subShifted;
+        CompareFn compare;
+        AddInPlaceFn addInPlace;
+    };
+
+    inline void addShiftedScalar(const char* a, size_t na, const char* b, size_t nb, size_t shift, char* out, size_t outLen) {
+        int carry = 0;
+        for (size_t k = 0; k < outLen; ++k) {
+            int digit1 = k < na ? a[na - 1 - k] - '0' : 0;
+            int digit2 = (k >= shift && k - shift < nb) ? b[nb - 1 - (k - shift)] - '0' : 0;
+            int sum = digit1 + digit2 + carry;
+            carry = sum >= 10;
+            out[outLen - 1 - k] = char(sum - 10 * carry + '0');
+        }
+    }
+
+    inline void subShiftedScalar(const char* a, size_t na, const char* b, size_t nb, size_t shift, char* out) {
+        int borrow = 0;
+        for (size_t k = 0; k < na; ++k) {
+            int digit1 = a[na - 1 - k] - '0';
+            int digit2 = (k >= shift && k - shift < nb) ? b[nb - 1 - (k - shift)] - '0' : 0;
+            int diff = digit1 - digit2 - borrow;
+            borrow = diff < 0;
+            out[na - 1 - k] = char(diff + 10 * borrow + '0');
+        }
+    }
+
+    // Carries one unit into the ASCII digits acc[0..len) from below
+    inline void propagateCarry(char* acc, size_t len, int carry) {
+        for (size_t k = len; carry && k-- > 0;) {
+            carry = acc[k] == '9';
+            acc[k] = carry ? '0' : char(acc[k] + 1);
+        }
+    }
+
+    inline void addInPlaceScalar(char* acc, size_t nacc, const char* b, size_t nb, size_t shift) {
+        char* region = acc + nacc - shift - nb;
+        int carry = 0;
+        for (size_t i = nb; i-- > 0;) {
+            int sum = (region[i] - '0') + (b[i] - '0') + carry;
+            carry = sum >= 10;
+            region[i] = char(sum - 10 * carry + '0');
+        }
+        propagateCarry(acc, nacc - shift - nb, carry);
+    }
+
+    inline int compareScalar(const char* a, size_t na, const char* b, size_t nb) {
+        if (na != nb) return na < nb ? -1 : 1;
+        int cmp = std::memcmp(a, b, na);
+        return (cmp > 0) - (cmp < 0);
+    }
+
+    // Scalar carry/borrow resolution for the most significant digits left over by the vector
+    // paths. Raw digits are in 0..18 (add) or -9..9 (sub); returns the carry out of the prefix.
+    inline int resolvePrefix(char* raw, size_t len, int carry, bool subtract) {
+        for (size_t k = len; k-- > 0;) {
+            int digit = raw[k] + (subtract ? -carry : carry);
+            if (subtract) {
+                carry = digit < 0;
+                digit += 10 * carry;
+            }
+            else {
+                carry = digit >= 10;
+                digit -= 10 * carry;
+            }
+            raw[k] = char(digit + '0');
+        }
+        return carry;
+    }
+
+#ifdef DIGIT_KERNELS_X86
+    // The vector kernels work in two passes. The first adds (subtracts) the digits of both
+    // operands position by position with no carries. The second resolves carries 64 digits at a
+    // time with carry-lookahead: per block, G marks digits that generate a carry (sum >= 10,
+    // difference < 0) and P the ones that propagate it (sum == 9, difference == 0), and the
+    // incoming carry of every digit is ((G << 1) + P + cin) ^ P, exactly as in a binary adder.
+
+    __attribute__((target("avx2")))
+    inline void rawAvx2(char* dst, const char* src, size_t n, bool subtract, char dstBias = 0) {
+        const __m256i zero = _mm256_set1_epi8('0'), bias = _mm256_set1_epi8(dstBias);
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            __m256i d = _mm256_sub_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i)), bias);
+            __m256i s = _mm256_sub_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)), zero);
+            d = subtract ? _mm256_sub_epi8(d, s) : _mm256_add_epi8(d, s);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), d);
+        }
+        for (; i < n; ++i) dst[i] = char(subtract ? dst[i] - dstBias - (src[i] - '0') : dst[i] - dstBias + (src[i] - '0'));
+    }
+
+    // Reverses the 32 bytes of a register, so that bit i of a movemask is the i-th least
+    // significant digit of a block.
+    __attribute__((target("avx2")))
+    inline __m256i reverseAvx2(__m256i v) {
+        const __m256i rev = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+            15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+        return _mm256_permute4x64_epi64(_mm256_shuffle_epi8(v, rev), 0x4E);
+    }
+
+    // Expands the 32 bits of a mask into 32 bytes of 0xFF / 0x00
+    __attribute__((target("avx2")))
+    inline __m256i expandMaskAvx2(uint32_t mask) {
+        const __m256i select = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+            2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+        const __m256i bits = _mm256_set1_epi64x(static_cast<long long>(0x8040201008040201ULL));
+        __m256i v = _mm256_shuffle_epi8(_mm256_set1_epi32(static_cast<int>(mask)), select);
+        return _mm256_cmpeq_epi8(_mm256_and_si256(v, bits), bits);
+    }
+
+    __attribute__((target("avx2")))
+    inline int resolveAvx2(char* raw, size_t len, bool subtract) {
+        const __m256i nine = _mm256_set1_epi8(9), ten = _mm256_set1_epi8(10);
+        const __m256i zero = _mm256_setzero_si256(), ascii = _mm256_set1_epi8('0');
+        uint64_t carry = 0;
+        size_t end = len;
+        for (; end >= 64; end -= 64) {
+            char* block = raw + end - 64;
+            __m256i lo = reverseAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32)));
+            __m256i hi = reverseAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(block)));
+            __m256i genLo = subtract ? _mm256_cmpgt_epi8(zero, lo) : _mm256_cmpgt_epi8(lo, nine);
+            __m256i genHi = subtract ? _mm256_cmpgt_epi8(zero, hi) : _mm256_cmpgt_epi8(hi, nine);
+            __m256i propLo = _mm256_cmpeq_epi8(lo, subtract ? zero : nine);
+            __m256i propHi = _mm256_cmpeq_epi8(hi, subtract ? zero : nine);
+            uint64_t g = uint32_t(_mm256_movemask_epi8(genLo)) | (uint64_t(uint32_t(_mm256_movemask_epi8(genHi))) << 32);
+            uint64_t p = uint32_t(_mm256_movemask_epi8(propLo)) | (uint64_t(uint32_t(_mm256_movemask_epi8(propHi))) << 32);
+            uint64_t c = ((g << 1) + p + carry) ^ p;
+            carry = (g >> 63) | ((p >> 63) & (c >> 63));
+
+            // Apply the incoming carries (the mask bytes are -1, so subtracting adds one)
+            __m256i cLo = expandMaskAvx2(uint32_t(c)), cHi = expandMaskAvx2(uint32_t(c >> 32));
+            lo = subtract ? _mm256_add_epi8(lo, cLo) : _mm256_sub_epi8(lo, cLo);
+            hi = subtract ? _mm256_add_epi8(hi, cHi) : _mm256_sub_epi8(hi, cHi);
+            if (subtract) {
+                lo = _mm256_add_epi8(lo, _mm256_and_si256(_mm256_cmpgt_epi8(zero, lo), ten));
+                hi = _mm256_add_epi8(hi, _mm256_and_si256(_mm256_cmpgt_epi8(zero, hi), ten));
+            }
+            else {
+                lo = _mm256_sub_epi8(lo, _mm256_and_si256(_mm256_cmpgt_epi8(lo, nine), ten));
+                hi = _mm256_sub_epi8(hi, _mm256_and_si256(_mm256_cmpgt_epi8(hi, nine), ten));
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(block + 32), reverseAvx2(_mm256_add_epi8(lo, ascii)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(block), reverseAvx2(_mm256_add_epi8(hi, ascii)));
+        }
+        return resolvePrefix(raw, end, int(carry), subtract);
+    }
+
+    __attribute__((target("avx2")))
+    inline void addShiftedAvx2(const char* a, size_t na, const char* b, size_t nb, size_t shift, char* out, size_t outLen) {
+        std::memset(out, 0, outLen);
+        rawAvx2(out + outLen - na, a, na, false);
+        rawAvx2(out + outLen - shift - nb, b, nb, false);
+        resolveAvx2(out, outLen, false);
+    }
+
+    __attribute__((target("avx2")))
+    inline void subShiftedAvx2(const char* a, size_t na, const char* b, size_t nb, size_t shift, char* out) {
+        std::memset(out, 0, na);
+        rawAvx2(out, a, na, false);
+        rawAvx2(out + na - shift - nb, b, nb, true);
+        resolveAvx2(out, na, true);
+    }
+
+    __attribute__((target("avx2")))
+    inline void addInPlaceAvx2(char* acc, size_t nacc, const char* b, size_t nb, size_t shift) {
+        char* region = acc + nacc - shift - nb;
+        rawAvx2(region, b, nb, false, '0');
+        propagateCarry(acc, nacc - shift - nb, resolveAvx2(region, nb, false));
+    }
+
+    __attribute__((target("avx2")))
+    inline int compareAvx2(const char* a, size_t na, const char* b, size_t nb) {
+        if (na != nb) return na < nb ? -1 : 1;
+        size_t i = 0;
+        for (; i + 32 <= na; i += 32) {
+            __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+            uint32_t diff = ~uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)));
+            if (diff) {
+                size_t k = i + __builtin_ctz(diff);
+                return a[k] < b[k] ? -1 : 1;
+            }
+        }
+        return compareScalar(a + i, na - i, b + i, nb - i);
+    }
+
+    __attribute__((target("avx512f,avx512bw")))
+    inline void rawAvx512(char* dst, const char* src, size_t n, bool subtract, char dstBias = 0) {
+        const __m512i zero = _mm512_set1_epi8('0'), bias = _mm512_set1_epi8(dstBias);
+        size_t i = 0;
+        for (; i + 64 <= n; i += 64) {
+            __m512i d = _mm512_sub_epi8(_mm512_loadu_si512(dst + i), bias);
+            __m512i s = _mm512_sub_epi8(_mm512_loadu_si512(src + i), zero);
+            _mm512_storeu_si512(dst + i, subtract ? _mm512_sub_epi8(d, s) : _mm512_add_epi8(d, s));
+        }
+        if (i < n) {
+            __mmask64 tail = ~0ULL >> (64 - (n - i));
+            __m512i d = _mm512_sub_epi8(_mm512_maskz_loadu_epi8(tail, dst + i), bias);
+            __m512i s = _mm512_maskz_sub_epi8(tail, _mm512_maskz_loadu_epi8(tail, src + i), zero);
+            _mm512_mask_storeu_epi8(dst + i, tail, subtract ? _mm512_sub_epi8(d, s) : _mm512_add_epi8(d, s));
+        }
+    }
+
+    __attribute__((target("avx512f,avx512bw")))
+    inline __m512i reverseAvx512(__m512i v) {
+        const __m512i rev = _mm512_set_epi64(0x0001020304050607LL, 0x08090A0B0C0D0E0FLL, 0x0001020304050607LL, 0x08090A0B0C0D0E0FLL,
+            0x0001020304050607LL, 0x08090A0B0C0D0E0FLL, 0x0001020304050607LL, 0x08090A0B0C0D0E0FLL);
+        // Bytes reversed within each 128-bit lane, then the lanes reversed: 64-bit words 6 7 4 5 2 3 0 1.
+        // The zero-masked permute with a full mask avoids the unmasked form's undefined source,
+        // which GCC reports as maybe-uninitialized.
+        const __m512i lanes = _mm512_set_epi64(1, 0, 3, 2, 5, 4, 7, 6);
+        return _mm512_maskz_permutexvar_epi64(0xFF, lanes, _mm512_shuffle_epi8(v, rev));
+    }
+
+    __attribute__((target("avx512f,avx512bw")))
+    inline int resolveAvx512(char* raw, size_t len, bool subtract) {
+        const __m512i nine = _mm512_set1_epi8(9), ten = _mm512_set1_epi8(10), one = _mm512_set1_epi8(1);
+        const __m512i zero = _mm512_setzero_si512(), ascii = _mm512_set1_epi8('0');
+        uint64_t carry = 0;
+        size_t end = len;
+        for (; end >= 64; end -= 64) {
+            char* block = raw + end - 64;
+            __m512i v = reverseAvx512(_mm512_loadu_si512(block));
+            uint64_t g = subtract ? _mm512_cmplt_epi8_mask(v, zero) : _mm512_cmpgt_epi8_mask(v, nine);
+            uint64_t p = _mm512_cmpeq_epi8_mask(v, subtract ? zero : nine);
+            uint64_t c = ((g << 1) + p + carry) ^ p;
+            carry = (g >> 63) | ((p >> 63) & (c >> 63));
+            if (subtract) {
+                v = _mm512_mask_sub_epi8(v, c, v, one);
+                v = _mm512_mask_add_epi8(v, _mm512_cmplt_epi8_mask(v, zero), v, ten);
+            }
+            else {
+                v = _mm512_mask_add_epi8(v, c, v, one);
+                v = _mm512_mask_sub_epi8(v, _mm512_cmpgt_epi8_mask(v, nine), v, ten);
+            }
+            _mm512_storeu_si512(block, reverseAvx512(_mm512_add_epi8(v, ascii)));
+        }
+        return resolvePrefix(raw, end, int(carry), subtract);
+    }
+
+    __attribute__((target("avx512f,avx512bw")))
+    inline void addShiftedAvx512(const char* a, size_t na, const char* b, size_t nb, size_t shift, char* out, size_t outLen) {
+        std::memset(out, 0, outLen);
+        rawAvx512(out + outLen - na, a, na, false);
+        rawAvx512(out + outLen - shift - nb, b, nb, false);
+        resolveAvx512(out, outLen, false);
+    }
+
+    __attribute__((target("avx512f,avx512bw")))
+    inline void subShiftedAvx512(const char* a, size_t na, const char* b, size_t nb, size_t shift, char* out) {
+        std::memset(out, 0, na);
+        rawAvx512(out, a, na, false);
+        rawAvx512(out + na - shift - nb, b, nb, true);
+        resolveAvx512(out, na, true);
+    }
+
+    __attribute__((target("avx512f,avx512bw")))
+    inline void addInPlaceAvx512(char* acc, size_t nacc, const char* b, size_t nb, size_t shift) {
+        char* region = acc + nacc - shift - nb;
+        rawAvx512(region, b, nb, false, '0');
+        propagateCarry(acc, nacc - shift - nb, resolveAvx512(region, nb, false));
+    }
+
+    __attribute__((target("avx512f,avx512bw")))
+    inline int compareAvx512(const char* a, size_t na, const char* b, size_t nb) {
+        if (na != nb) return na < nb ? -1 : 1;
+        size_t i = 0;
+        for (; i + 64 <= na; i += 64) {
+            uint64_t diff = _mm512_cmpneq_epi8_mask(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+            if (diff) {
+                size_t k = i + __builtin_ctzll(diff);
+                return a[k] < b[k] ? -1 : 1;
+            }
+        }
+        return compareScalar(a + i, na - i, b + i, nb - i);
+    }
+#endif
+
+    // Every kernel set the running CPU supports, slowest first
+    inline std::vector<KernelTable> availableKernels() {
+        std::vector<KernelTable> tables;
+        tables.push_back({ "scalar", addShiftedScalar, subShiftedScalar, compareScalar, addInPlaceScalar });
+#ifdef DIGIT_KERNELS_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            tables.push_back({ "avx2", addShiftedAvx2, subShiftedAvx2, compareAvx2, addInPlaceAvx2 });
+        }
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+            tables.push_back({ "avx512", addShiftedAvx512, subShiftedAvx512, compareAvx512, addInPlaceAvx512 });
+        }
+#endif
+        return tables;
+    }
+
+    inline const KernelTable& active() {
+        static const KernelTable table = availableKernels().back();
+        return table;
+    }
+}
+
+// Optional per-operation counters, compiled in only with -DBIGINT_INSTRUMENTATION. Without the
+// flag the counting macros expand to nothing; snapshot() then reports all zeros.
+namespace instrumentation {
+    enum Operation { Add, Subtract, Multiply, Divide, Modulo, OperationCount };
+    enum Algorithm { Karatsuba, Toom3, Toom5, Toom32, Toom42, Chunked, AlgorithmCount };
+
+    const char* const operationNames[OperationCount] = { "+", "-", "*", "/", "%" };
+    const char* const algorithmNames[AlgorithmCount] = { "karatsuba", "toom3Multiply", "toom5Multiply", "toom32", "toom42", "chunked" };
+
+    // sizeBuckets[i] counts calls whose longer operand has [2^i, 2^(i+1)) digits
+    const int sizeBuckets = 32;
+
+    struct Snapshot {
+        bool enabled = false;
+        unsigned long long operationCalls[OperationCount] = {};
+        unsigned long long operandSizes[OperationCount][sizeBuckets] = {};
+        unsigned long long recursionCalls[AlgorithmCount] = {};
+        unsigned long long maxRecursionDepth[AlgorithmCount] = {};
+        unsigned long long bytesAllocated = 0;
+    };
+
+    struct Counters {
+        std::atomic<unsigned long long> operationCalls[OperationCount];
+        std::atomic<unsigned long long> operandSizes[OperationCount][sizeBuckets];
+        std::atomic<unsigned long long> recursionCalls[AlgorithmCount];
+        std::atomic<unsigned long long> maxRecursionDepth[AlgorithmCount];
+        std::atomic<unsigned long long> bytesAllocated;
+    };
+
+    inline Counters& counters() {
+        static Counters instance{};
+        return instance;
+    }
+
+    inline int sizeBucket(size_t digits) {
+        int bucket = 0;
+        while (digits > 1 && bucket < sizeBuckets - 1) {
+            digits >>= 1;
+            ++bucket;
+        }
+        return bucket;
+    }
+
+    inline void countOperation(Operation op, size_t digitsA, size_t digitsB) {
+        Counters& c = counters();
+        c.operationCalls[op].fetch_add(1, std::memory_order_relaxed);
+        c.operandSizes[op][sizeBucket(std::max(digitsA, digitsB))].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    inline void countAllocation(size_t bytes) {
+        counters().bytesAllocated.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    // Counts one recursion frame of an algorithm and tracks the deepest nesting seen
+    class RecursionScope {
+    public:
+        explicit RecursionScope(Algorithm algorithm) : algorithm(algorithm) {
+            Counters& c = counters();
+            c.recursionCalls[algorithm].fetch_add(1, std::memory_order_relaxed);
+            unsigned long long current = ++depth()[algorithm];
+            unsigned long long seen = c.maxRecursionDepth[algorithm].load(std::memory_order_relaxed);
+            while (current > seen && !c.maxRecursionDepth[algorithm].compare_exchange_weak(seen, current, std::memory_order_relaxed)) {}
+        }
+        ~RecursionScope() { --depth()[algorithm]; }
+
+    private:
+        static unsigned long long* depth() {
+            thread_local unsigned long long levels[AlgorithmCount] = {};
+            return levels;
+        }
+
+        Algorithm algorithm;
+    };
+
+    inline Snapshot snapshot() {
+        Snapshot s;
+#ifdef BIGINT_INSTRUMENTATION
+        Counters& c = counters();
+        s.enabled = true;
+        for (int op = 0; op < OperationCount; ++op) {
+            s.operationCalls[op] = c.operationCalls[op].load();
+            for (int i = 0; i < sizeBuckets; ++i) s.operandSizes[op][i] = c.operandSizes[op][i].load();
+        }
+        for (int a = 0; a < AlgorithmCount; ++a) {
+            s.recursionCalls[a] = c.recursionCalls[a].load();
+            s.maxRecursionDepth[a] = c.maxRecursionDepth[a].load();
+        }
+        s.bytesAllocated = c.bytesAllocated.load();
+#endif
+        return s;
+    }
+
+    inline void reset() {
+        Counters& c = counters();
+        for (int op = 0; op < OperationCount; ++op) {
+            c.operationCalls[op] = 0;
+            for (int i = 0; i < sizeBuckets; ++i) c.operandSizes[op][i] = 0;
+        }
+        for (int a = 0; a < AlgorithmCount; ++a) {
+            c.recursionCalls[a] = 0;
+            c.maxRecursionDepth[a] = 0;
+        }
+        c.bytesAllocated = 0;
+    }
+
+    inline void dumpJson(std::ostream& os, const Snapshot& s = snapshot()) {
+        os << "{\"enabled\":" << (s.enabled ? "true" : "false") << ",\"operations\":{";
+        for (int op = 0; op < OperationCount; ++op) {
+            os << (op ? "," : "") << "\"" << operationNames[op] << "\":{\"calls\":" << s.operationCalls[op] << ",\"operandDigits\":{";
+            bool first = true;
+            for (int i = 0; i < sizeBuckets; ++i) {
+                if (!s.operandSizes[op][i]) continue;
+                os << (first ? "" : ",") << "\"" << (1ULL << i) << "-" << ((2ULL << i) - 1) << "\":" << s.operandSizes[op][i];
+                first = false;
+            }
+            os << "}}";
+        }
+        os << "},\"recursion\":{";
+        for (int a = 0; a < AlgorithmCount; ++a) {
+            os << (a ? "," : "") << "\"" << algorithmNames[a] << "\":{\"calls\":" << s.recursionCalls[a]
+                << ",\"maxDepth\":" << s.maxRecursionDepth[a] << "}";
+        }
+        os << "},\"bytesAllocated\":" << s.bytesAllocated << "}\n";
+    }
+}
+
+#ifdef BIGINT_INSTRUMENTATION
+#define BIGINT_COUNT_OPERATION(op, digitsA, digitsB) instrumentation::countOperation(instrumentation::op, (digitsA), (digitsB))
+#define BIGINT_COUNT_ALLOCATION(bytes) instrumentation::countAllocation(bytes)
+#define BIGINT_RECURSION_SCOPE(algorithm) instrumentation::RecursionScope recursionScope(algorithm)
+#else
+#define BIGINT_COUNT_OPERATION(op, digitsA, digitsB) ((void)0)
+#define BIGINT_COUNT_ALLOCATION(bytes) ((void)0)
+#define BIGINT_RECURSION_SCOPE(algorithm) ((void)0)
+#endif
+
+// Stack-discipline scratch memory for the multiplication recursions. Every recursion frame takes
+// a mark on entry and releases back to it on exit, so one buffer sized from the operand lengths
+// serves the whole call tree. If the estimate is ever too small, another chunk is added.
+class ScratchArena {
+public:
+    struct Mark {
+        size_t chunk;
+        size_t used;
+    };
+
+    explicit ScratchArena(size_t bytes) : current(0), allocations(0) {
+        chunks.reserve(16);
+        addChunk(bytes);
+    }
+
+    // Upper estimate of the scratch a Karatsuba/Toom product of na x nb digits needs
+    static size_t bytesForMultiply(size_t na, size_t nb) {
+        return 64 * (na + nb) + 4096;
+    }
+
+    template <typename T>
+    T* allocate(size_t count) {
+        size_t bytes = count * sizeof(T);
+        while (true) {
+            Chunk& chunk = chunks[current];
+            size_t start = (chunk.used + alignof(T) - 1) / alignof(T) * alignof(T);
+            if (start + bytes <= chunk.size) {
+                chunk.used = start + bytes;
+                return reinterpret_cast<T*>(chunk.data.get() + start);
+            }
+            if (current + 1 == chunks.size()) addChunk(std::max(bytes + alignof(T), 2 * chunk.size));
+            chunks[++current].used = 0;
+        }
+    }
+
+    Mark mark() const { return { current, chunks[current].used }; }
+
+    void release(const Mark& start) {
+        current = start.chunk;
+        chunks[current].used = start.used;
+    }
+
+    // Number of heap blocks the arena has requested so far
+    size_t heapAllocations() const { return allocations; }
+
+private:
+    struct Chunk {
+        std::unique_ptr<char[]> data;
+        size_t size;
+        size_t used;
+    };
+
+    void addChunk(size_t bytes) {
+        BIGINT_COUNT_ALLOCATION(bytes);
+        chunks.push_back({ std::unique_ptr<char[]>(new char[bytes]), bytes, 0 });
+        ++allocations;
+    }
+
+    std::vector<Chunk> chunks;
+    size_t current;
+    size_t allocations;
+};
+
+// Releases everything a recursion frame allocated when it goes out of scope
+class ScratchFrame {
+public:
+    explicit ScratchFrame(ScratchArena& arena) : arena(arena), start(arena.mark()) {}
+    ~ScratchFrame() { arena.release(start); }
+
+private:
+    ScratchArena& arena;
+    ScratchArena::Mark start;
+};
+
+// Non-owning view of unsigned decimal digits (most significant first, leading zeros allowed)
+struct DigitView {
+    const char* digits;
+    size_t size;
+
+    DigitView trimmed() const {
+        size_t skip = 0;
+        while (skip < size && digits[skip] == '0') ++skip;
+        return { digits + skip, size - skip };
+    }
+
+    // The `count` least significant digits
+    DigitView low(size_t count) const { return count >= size ? *this : DigitView{ digits + size - count, count }; }
+
+    // Everything above the `count` least significant digits
+    DigitView high(size_t count) const { return count >= size ? DigitView{ digits + size, 0 } : DigitView{ digits, size - count }; }
+
+    // The i-th block of `part` digits, counting from the least significant end
+    DigitView limb(size_t i, size_t part) const { return high(i * part).low(part); }
+};
+
+// Signed arena-backed value for the Toom evaluation and interpolation temporaries
+struct ScratchInt {
+    DigitView magnitude;
+    bool negative;
+};
+
+namespace scratchMath {
+    inline ScratchInt negate(ScratchInt a) {
+        a.negative = !a.negative && a.magnitude.trimmed().size != 0;
+        return a;
+    }
+
+    inline ScratchInt add(ScratchArena& arena, ScratchInt a, ScratchInt b) {
+        const digitKernels::KernelTable& kernels = digitKernels::active();
+        DigitView x = a.magnitude.trimmed(), y = b.magnitude.trimmed();
+        if (y.size == 0) return { x, a.negative && x.size != 0 };
+        if (x.size == 0) return { y, b.negative };
+
+        if (a.negative == b.negative) {
+            size_t length = std::max(x.size, y.size) + 1;
+            char* out = arena.allocate<char>(length);
+            kernels.addShifted(x.digits, x.size, y.digits, y.size, 0, out, length);
+            return { DigitView{ out, length }.trimmed(), a.negative };
+        }
+
+        // Different signs: subtract the smaller magnitude from the larger one
+        int cmp = kernels.compare(x.digits, x.size, y.digits, y.size);
+        if (cmp == 0) return { DigitView{ x.digits, 0 }, false };
+        bool negative = a.negative;
+        if (cmp < 0) {
+            std::swap(x, y);
+            negative = b.negative;
+        }
+        char* out = arena.allocate<char>(x.size);
+        kernels.subShifted(x.digits, x.size, y.digits, y.size, 0, out);
+        return { DigitView{ out, x.size }.trimmed(), negative };
+    }
+
+    inline ScratchInt sub(ScratchArena& arena, ScratchInt a, ScratchInt b) {
+        return add(arena, a, negate(b));
+    }
+
+    // The fused kernels below read and write the digits 8 at a time as base-10^8 chunks,
+    // counted from the least significant end; the top chunk may be shorter
+    const uint64_t chunkBase = 100000000;
+
+    inline size_t chunkCount(size_t digits) { return (digits + 7) / 8; }
+
+    inline uint64_t loadChunk(DigitView x, size_t i) {
+        size_t end = x.size - std::min(x.size, 8 * i);
+        uint64_t value = 0;
+        for (size_t k = end - std::min<size_t>(end, 8); k < end; ++k) value = value * 10 + uint64_t(x.digits[k] - '0');
+        return value;
+    }
+
+    inline void storeChunk(char* out, size_t length, size_t i, uint64_t value) {
+        static const char pairs[] =
+            "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+            "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+            "8081828384858687888990919293949596979899";
+        size_t end = length - 8 * i, begin = end - std::min<size_t>(end, 8);
+        if (end - begin == 8) {
+            uint32_t high = uint32_t(value / 10000), low = uint32_t(value % 10000);
+            std::memcpy(out + begin, pairs + 2 * (high / 100), 2);
+            std::memcpy(out + begin + 2, pairs + 2 * (high % 100), 2);
+            std::memcpy(out + begin + 4, pairs + 2 * (low / 100), 2);
+            std::memcpy(out + begin + 6, pairs + 2 * (low % 100), 2);
+            return;
+        }
+        for (size_t k = end; k-- > begin;) {
+            out[k] = char('0' + value % 10);
+            value /= 10;
+        }
+    }
+
+    // a + b * factor in one pass, for |factor| < 2^36 (a chunk times the factor stays far
+    // inside 64 bits). Factors of +-1 go through the vectorized add and subtract kernels.
+    inline ScratchInt addMul(ScratchArena& arena, ScratchInt a, ScratchInt b, long long factor) {
+        DigitView x = a.magnitude.trimmed(), y = b.magnitude.trimmed();
+        uint64_t f = factor < 0 ? 0ULL - static_cast<uint64_t>(factor) : factor;
+        bool productNegative = b.negative != (factor < 0);
+        if (y.size == 0 || f == 0) return { x, a.negative && x.size != 0 };
+        if (f == 1) return add(arena, { x, a.negative }, { y, productNegative });
+        if (x.size == 0) a.negative = productNegative;
+
+        // |a| +- |b| * f with a signed carry; a final borrow means the product term was larger
+        bool subtract = x.size != 0 && a.negative != productNegative;
+        size_t chunks = std::max(chunkCount(x.size), chunkCount(y.size) + 2) + 1;
+        size_t length = 8 * chunks;
+        char* out = arena.allocate<char>(length);
+        int64_t carry = 0;
+        for (size_t i = 0; i < chunks; ++i) {
+            int64_t product = int64_t(loadChunk(y, i) * f);
+            int64_t current = int64_t(loadChunk(x, i)) + (subtract ? -product : product) + carry;
+            carry = current / int64_t(chunkBase);
+            current %= int64_t(chunkBase);
+            if (current < 0) {
+                current += chunkBase;
+                --carry;
+            }
+            storeChunk(out, length, i, uint64_t(current));
+        }
+
+        bool negative = a.negative;
+        if (carry < 0) {
+            // The stored value is 10^length - |result|: complement it and flip the sign
+            int64_t borrow = 0;
+            for (size_t i = 0; i < chunks; ++i) {
+                int64_t current = -int64_t(loadChunk({ out, length }, i)) - borrow;
+                borrow = current < 0;
+                storeChunk(out, length, i, uint64_t(current + (borrow ? int64_t(chunkBase) : 0)));
+            }
+            negative = !negative;
+        }
+        DigitView result = DigitView{ out, length }.trimmed();
+        return { result, negative && result.size != 0 };
+    }
+
+    inline ScratchInt mulSmall(ScratchArena& arena, ScratchInt a, long long factor) {
+        return addMul(arena, { DigitView{ a.magnitude.digits, 0 }, false }, a, factor);
+    }
+
+    // a / divisor for a divisor below 2^36 that is known to divide a. Factors 2 and 5 of the
+    // divisor go first: x / 2 = 5x / 10, x / 5 = 2x / 10, and the dropped digits are zero.
+    // The rest, coprime to 10, is divided out from the least significant chunk up by
+    // multiplying with its inverse modulo 10^8, without a single hardware division.
+    inline ScratchInt divExactSmall(ScratchArena& arena, ScratchInt a, long long divisor) {
+        bool negative = a.negative != (divisor < 0);
+        uint64_t m = divisor < 0 ? 0ULL - static_cast<uint64_t>(divisor) : divisor;
+        ScratchInt x = { a.magnitude.trimmed(), false };
+        while (m % 2 == 0 || m % 5 == 0) {
+            long long scale = 1;
+            size_t shift = 0;
+            for (; shift < 10 && (m % 2 == 0 || m % 5 == 0); ++shift) {
+                scale *= m % 2 == 0 ? 5 : 2;
+                m /= m % 2 == 0 ? 2 : 5;
+            }
+            x = mulSmall(arena, x, scale);
+            x.magnitude = x.magnitude.high(shift);
+        }
+        if (m != 1 && x.magnitude.size != 0) {
+            // Newton's iteration lifts the inverse modulo 10 to 10^2, 10^4 and 10^8
+            static const uint64_t inverseMod10[10] = { 0, 1, 0, 7, 0, 0, 0, 3, 0, 9 };
+            uint64_t inverse = inverseMod10[m % 10];
+            for (int i = 0; i < 3; ++i) {
+                uint64_t error = m % chunkBase * inverse % chunkBase;
+                inverse = inverse * ((2 + chunkBase - error) % chunkBase) % chunkBase;
+            }
+
+            DigitView y = x.magnitude;
+            size_t chunks = chunkCount(y.size), length = 8 * chunks;
+            char* out = arena.allocate<char>(length);
+            uint64_t borrow = 0;
+            for (size_t i = 0; i < chunks; ++i) {
+                uint64_t chunk = loadChunk(y, i), extra = 0;
+                if (chunk < borrow) {
+                    chunk += chunkBase * ((borrow - chunk + chunkBase - 1) / chunkBase);
+                    extra = (chunk - loadChunk(y, i)) / chunkBase;
+                }
+                chunk -= borrow;
+                uint64_t quotient = chunk * inverse % chunkBase;
+                borrow = (quotient * m - chunk) / chunkBase + extra;
+                storeChunk(out, length, i, quotient);
+            }
+            x.magnitude = DigitView{ out, length }.trimmed();
+        }
+        return { x.magnitude, negative && x.magnitude.size != 0 };
+    }
+}
+
+// Operands below this many digits (the shorter one) are multiplied by the schoolbook method
+size_t schoolbookThreshold = 32;
+// Below this many digits (the shorter operand) the Toom variants hand over to Karatsuba, whose
+// split costs three additions instead of a full evaluation and interpolation
+size_t toomThreshold = 512;
+// Once the longer operand is this many times the shorter, it is multiplied in chunks
+size_t chunkRatio = 3;
+
+// out[0..x.size + y.size) = x * y, for trimmed non-zero operands
+typedef void (*DigitMultiplier)(DigitView x, DigitView y, char* out, ScratchArena& arena);
+
+void schoolbookDigits(DigitView x, DigitView y, char* out, ScratchArena& arena) {
+    ScratchFrame frame(arena);
+    size_t length = x.size + y.size;
+    uint32_t* columns = arena.allocate<uint32_t>(length);
+    std::fill(columns, columns + length, 0);
+
+    // Digit x[i] * y[j] lands in column i + j + 1 (most significant first)
+    for (size_t i = 0; i < x.size; ++i) {
+        uint32_t digit = x.digits[i] - '0';
+        if (digit == 0) continue;
+        for (size_t j = 0; j < y.size; ++j) {
+            columns[i + j + 1] += digit * uint32_t(y.digits[j] - '0');
+        }
+    }
+
+    uint32_t carry = 0;
+    for (size_t k = length; k-- > 0;) {
+        uint32_t current = columns[k] + carry;
+        out[k] = char(current % 10 + '0');
+        carry = current / 10;
+    }
+}
+
+void chunkedDigits(DigitView x, DigitView y, char* out, ScratchArena& arena, DigitMultiplier algorithm);
+
+// Multiplies arbitrary (possibly zero or zero-padded) views into out[0..x.size + y.size),
+// falling back to the schoolbook method once the shorter operand is small enough and
+// cutting the longer operand into chunks when it is at least twice as long
+void multiplyInto(DigitView x, DigitView y, char* out, ScratchArena& arena, DigitMultiplier algorithm) {
+    size_t length = x.size + y.size;
+    x = x.trimmed();
+    y = y.trimmed();
+    if (x.size == 0 || y.size == 0) {
+        std::memset(out, '0', length);
+        return;
+    }
+
+    size_t used = x.size + y.size;
+    std::memset(out, '0', length - used);
+    out += length - used;
+    if (std::min(x.size, y.size) <= schoolbookThreshold) {
+        schoolbookDigits(x, y, out, arena);
+    }
+    else if (x.size >= chunkRatio * y.size) {
+        chunkedDigits(x, y, out, arena, algorithm);
+    }
+    else if (y.size >= chunkRatio * x.size) {
+        chunkedDigits(y, x, out, arena, algorithm);
+    }
+    else {
+        algorithm(x, y, out, arena);
+    }
+}
+
+// Long operand x cut into pieces the length of y; each piece product is added in at its place
+void chunkedDigits(DigitView x, DigitView y, char* out, ScratchArena& arena, DigitMultiplier algorithm) {
+    BIGINT_RECURSION_SCOPE(instrumentation::Chunked);
+    ScratchFrame frame(arena);
+    size_t length = x.size + y.size;
+    char* piece = arena.allocate<char>(2 * y.size);
+
+    std::memset(out, '0', length);
+    for (size_t shift = 0; shift < x.size; shift += y.size) {
+        size_t size = std::min(y.size, x.size - shift);
+        DigitView chunk = DigitView{ x.digits + x.size - shift - size, size }.trimmed();
+        if (chunk.size == 0) continue;
+        multiplyInto(chunk, y, piece, arena, algorithm);
+        DigitView product = DigitView{ piece, chunk.size + y.size }.trimmed();
+        digitKernels::active().addInPlace(out, length, product.digits, product.size, shift);
+    }
+}
+
+void karatsubaDigits(DigitView x, DigitView y, char* out, ScratchArena& arena) {
+    BIGINT_RECURSION_SCOPE(instrumentation::Karatsuba);
+    ScratchFrame frame(arena);
+    size_t length = x.size + y.size;
+    size_t half = std::max(x.size, y.size) / 2;
+
+    // Split both operands at the same position; the halves are views, not copies
+    DigitView x1 = x.high(half), x0 = x.low(half);
+    DigitView y1 = y.high(half), y0 = y.low(half);
+
+    // z0 and z2 are computed straight into their (disjoint) places in the output;
+    // z2 is zero when the shorter operand has no high half
+    std::memset(out, '0', length);
+    size_t z0Length = x0.size + y0.size;
+    size_t z2Length = (x1.size != 0 && y1.size != 0) ? x1.size + y1.size : 0;
+    char* z0 = out + length - z0Length;
+    char* z2 = out + length - 2 * half - z2Length;
+    multiplyInto(x0, y0, z0, arena, karatsubaDigits);
+    if (z2Length != 0) multiplyInto(x1, y1, z2, arena, karatsubaDigits);
+
+    // z1 = (x1 + x0)(y1 + y0) - z2 - z0
+    ScratchInt sx = scratchMath::add(arena, { x1, false }, { x0, false });
+    ScratchInt sy = scratchMath::add(arena, { y1, false }, { y0, false });
+    size_t middleLength = sx.magnitude.size + sy.magnitude.size;
+    char* middle = arena.allocate<char>(middleLength);
+    multiplyInto(sx.magnitude, sy.magnitude, middle, arena, karatsubaDigits);
+    ScratchInt z1 = scratchMath::sub(arena, { DigitView{ middle, middleLength }, false }, { DigitView{ z2, z2Length }, false });
+    z1 = scratchMath::sub(arena, z1, { DigitView{ z0, z0Length }, false });
+
+    digitKernels::active().addInPlace(out, length, z1.magnitude.digits, z1.magnitude.size, half);
+}
+
+// Split counts and evaluation points of a Toom-Cook variant. x is cut into partsX limbs and
+// y into partsY limbs of the same width; besides the finite points the product is also
+// evaluated at infinity, so there are partsX + partsY - 2 finite points.
+struct ToomScheme {
+    size_t partsX, partsY;
+    int points[8];
+    instrumentation::Algorithm algorithm;
+};
+
+const ToomScheme toom3Scheme = { 3, 3, { 0, 1, -1, -2 }, instrumentation::Toom3 };
+const ToomScheme toom5Scheme = { 5, 5, { 0, 1, -1, 2, -2, 3, -3, 4 }, instrumentation::Toom5 };
+// Unbalanced variants for an x roughly 1.5 and 2 times as long as y
+const ToomScheme toom32Scheme = { 3, 2, { 0, 1, -1 }, instrumentation::Toom32 };
+const ToomScheme toom42Scheme = { 4, 2, { 0, 1, -1, -2 }, instrumentation::Toom42 };
+
+// Horner sum of limbs first, first + stride, first + 2 stride, ... of x at point t, i.e. the sum
+// of limb(first + k stride) * t^k, one fused multiply-add per limb
+ScratchInt hornerLimbs(ScratchArena& arena, DigitView x, size_t part, size_t parts, size_t first, size_t stride, long long t) {
+    size_t top = first + (parts - 1 - first) / stride * stride;
+    ScratchInt acc = { x.limb(top, part), false };
+    for (size_t i = top; i >= first + stride; i -= stride) {
+        acc = scratchMath::addMul(arena, { x.limb(i - stride, part), false }, acc, t);
+    }
+    return acc;
+}
+
+// Values of the polynomial whose coefficients are the `part`-digit limbs of x at the scheme's
+// points. A pair +-t shares one even and one odd Horner sum in t^2: p(+-t) = even +- t * odd.
+void evaluateLimbs(ScratchArena& arena, const ToomScheme& scheme, size_t points, DigitView x, size_t part, size_t parts, ScratchInt* values) {
+    for (size_t j = 0; j < points; ++j) {
+        int t = scheme.points[j];
+        const int* mirror = std::find(scheme.points, scheme.points + points, -t);
+        if (t < 0 && mirror != scheme.points + points) continue;
+
+        if (t == 0) {
+            values[j] = { x.limb(0, part), false };
+        }
+        else if (mirror == scheme.points + points || parts < 2) {
+            values[j] = hornerLimbs(arena, x, part, parts, 0, 1, t);
+        }
+        else {
+            ScratchInt even = hornerLimbs(arena, x, part, parts, 0, 2, 1LL * t * t);
+            ScratchInt odd = hornerLimbs(arena, x, part, parts, 1, 2, 1LL * t * t);
+            odd = scratchMath::mulSmall(arena, odd, t);
+            values[j] = scratchMath::add(arena, even, odd);
+            values[mirror - scheme.points] = scratchMath::sub(arena, even, odd);
+        }
+    }
+}
+
+void toomDigits(const ToomScheme& scheme, DigitMultiplier self, DigitView x, DigitView y, char* out, ScratchArena& arena) {
+    BIGINT_RECURSION_SCOPE(scheme.algorithm);
+    ScratchFrame frame(arena);
+    const size_t partsX = scheme.partsX, partsY = scheme.partsY, points = partsX + partsY - 2;
+    size_t length = x.size + y.size;
+    size_t part = std::max((x.size + partsX - 1) / partsX, (y.size + partsY - 1) / partsY);
+
+    // Pointwise products at the finite points, then the leading coefficient (the point at infinity)
+    ScratchInt r[8], xValues[8], yValues[8];
+    evaluateLimbs(arena, scheme, points, x, part, partsX, xValues);
+    evaluateLimbs(arena, scheme, points, y, part, partsY, yValues);
+    for (size_t j = 0; j < points; ++j) {
+        ScratchInt p = xValues[j], q = yValues[j];
+        size_t productLength = p.magnitude.size + q.magnitude.size;
+        char* product = arena.allocate<char>(productLength);
+        multiplyInto(p.magnitude, q.magnitude, product, arena, self);
+        r[j] = { DigitView{ product, productLength }.trimmed(), p.negative != q.negative };
+    }
+    DigitView xTop = x.limb(partsX - 1, part), yTop = y.limb(partsY - 1, part);
+    char* topDigits = arena.allocate<char>(xTop.size + yTop.size);
+    multiplyInto(xTop, yTop, topDigits, arena, self);
+    ScratchInt top = { DigitView{ topDigits, xTop.size + yTop.size }.trimmed(), false };
+
+    // Remove the leading term, leaving a polynomial of degree points - 1 through the finite points
+    for (size_t j = 0; j < points; ++j) {
+        long long t = scheme.points[j], tPower = 1;
+        for (size_t i = 0; i < points; ++i) tPower *= t;
+        r[j] = scratchMath::addMul(arena, r[j], top, -tPower);
+    }
+
+    // Newton divided differences; with integer nodes and coefficients every division is exact
+    for (size_t level = 1; level < points; ++level) {
+        for (size_t j = points - 1; j >= level; --j) {
+            ScratchInt difference = scratchMath::sub(arena, r[j], r[j - 1]);
+            r[j] = scratchMath::divExactSmall(arena, difference, scheme.points[j] - scheme.points[j - level]);
+        }
+    }
+
+    // Expand the Newton form into ordinary coefficients: c(x) = c(x) * (x - t_j) + r[j]
+    ScratchInt c[9];
+    size_t degree = 0;
+    c[0] = r[points - 1];
+    for (size_t j = points - 1; j-- > 0;) {
+        int t = scheme.points[j];
+        c[degree + 1] = c[degree];
+        for (size_t i = degree; i >= 1; --i) {
+            c[i] = scratchMath::addMul(arena, c[i - 1], c[i], -t);
+        }
+        c[0] = scratchMath::addMul(arena, r[j], c[0], -t);
+        ++degree;
+    }
+    c[points] = top;
+
+    // Recompose: every coefficient of the product of two non-negative numbers is non-negative
+    std::memset(out, '0', length);
+    for (size_t i = 0; i <= points; ++i) {
+        DigitView coefficient = c[i].magnitude.trimmed();
+        digitKernels::active().addInPlace(out, length, coefficient.digits, coefficient.size, i * part);
+    }
+}
+
+void toom3Digits(DigitView x, DigitView y, char* out, ScratchArena& arena) {
+    if (std::min(x.size, y.size) < toomThreshold) {
+        karatsubaDigits(x, y, out, arena);
+        return;
+    }
+    toomDigits(toom3Scheme, toom3Digits, x, y, out, arena);
+}
+
+void toom5Digits(DigitView x, DigitView y, char* out, ScratchArena& arena) {
+    if (std::min(x.size, y.size) < toomThreshold) {
+        karatsubaDigits(x, y, out, arena);
+        return;
+    }
+    toomDigits(toom5Scheme, toom5Digits, x, y, out, arena);
+}
+
+// Picks the split from the size ratio: Toom-42 and Toom-32 keep every limb of an unbalanced
+// product full, near-equal operands go to Toom-3, and everything below toomThreshold to
+// Karatsuba. Ratios of chunkRatio and more never get here, multiplyInto cuts those into
+// chunks first.
+void adaptiveDigits(DigitView x, DigitView y, char* out, ScratchArena& arena) {
+    if (x.size < y.size) std::swap(x, y);
+    if (y.size < toomThreshold) {
+        karatsubaDigits(x, y, out, arena);
+    }
+    else if (4 * x.size >= 7 * y.size) {
+        toomDigits(toom42Scheme, adaptiveDigits, x, y, out, arena);
+    }
+    else if (4 * x.size >= 5 * y.size) {
+        toomDigits(toom32Scheme, adaptiveDigits, x, y, out, arena);
+    }
+    else {
+        toomDigits(toom3Scheme, adaptiveDigits, x, y, out, arena);
+    }
+}
+
+// Unsigned decimal magnitudes (most significant digit first, no leading zeros) shared by BigInt
+// and BigNat, so both classes get the same kernels, multiplication and division.
+namespace magnitude {
+    // Strips leading zeros in place; an empty or all-zero string becomes "0"
+    inline std::string fromDigits(std::string digits) {
+        size_t start = digits.find_first_not_of('0');
+        if (start == std::string::npos) return "0";
+        digits.erase(0, start);
+        return digits;
+    }
+
+    inline int compare(const std::string& a, const std::string& b) {
+        return digitKernels::active().compare(a.data(), a.size(), b.data(), b.size());
+    }
+
+    // a + b * 10^shift
+    inline std::string addShifted(const std::string& a, const std::string& b, size_t shift) {
+        std::string result(std::max(a.size(), b.size() + shift) + 1, '0');
+        BIGINT_COUNT_ALLOCATION(result.size());
+        digitKernels::active().addShifted(a.data(), a.size(), b.data(), b.size(), shift, &result[0], result.size());
+        return fromDigits(std::move(result));
+    }
+
+    inline std::string add(const std::string& a, const std::string& b) {
+        return addShifted(a, b, 0);
+    }
+
+    // a - b, requires a >= b
+    inline std::string sub(const std::string& a, const std::string& b) {
+        std::string result(a.size(), '0');
+        BIGINT_COUNT_ALLOCATION(result.size());
+        digitKernels::active().subShifted(a.data(), a.size(), b.data(), b.size(), 0, &result[0]);
+        return fromDigits(std::move(result));
+    }
+
+    inline std::string multiply(const std::string& a, const std::string& b) {
+        if (a == "0" || b == "0") return "0";
+        bool small = std::min(a.size(), b.size()) <= schoolbookThreshold;
+        ScratchArena arena(small ? 4 * (a.size() + b.size()) + 64 : ScratchArena::bytesForMultiply(a.size(), b.size()));
+        std::string product(a.size() + b.size(), '0');
+        BIGINT_COUNT_ALLOCATION(product.size());
+        multiplyInto({ a.data(), a.size() }, { b.data(), b.size() }, &product[0], arena, adaptiveDigits);
+        return fromDigits(std::move(product));
+    }
+
+    // a * m in one pass, for m <= 2^60 (digit * m + carry stays below 2^64)
+    inline std::string mulSmall(const std::string& a, uint64_t m) {
+        std::string result(a.size() + 19, '0');
+        uint64_t carry = 0;
+        size_t k = result.size();
+        for (size_t i = a.size(); i-- > 0;) {
+            uint64_t current = uint64_t(a[i] - '0') * m + carry;
+            result[--k] = char('0' + current % 10);
+            carry = current / 10;
+        }
+        while (carry != 0) {
+            result[--k] = char('0' + carry % 10);
+            carry /= 10;
+        }
+        return fromDigits(std::move(result));
+    }
+
+    // { a / d, a % d } in one pass, for 0 < d <= 2^60
+    inline std::pair<std::string, uint64_t> divSmall(const std::string& a, uint64_t d) {
+        std::string quotient(a.size(), '0');
+        uint64_t remainder = 0;
+        for (size_t i = 0; i < a.size(); ++i) {
+            remainder = remainder * 10 + uint64_t(a[i] - '0');
+            quotient[i] = char('0' + remainder / d);
+            remainder %= d;
+        }
+        return { fromDigits(std::move(quotient)), remainder };
+    }
+
+    // Schoolbook long division, returns { a / b, a % b }; b must not be zero
+    inline std::pair<std::string, std::string> divMod(const std::string& a, const std::string& b) {
+        if (compare(a, b) < 0) return { "0", a };
+
+        // 0, b, 2b, ..., 9b for picking each quotient digit
+        std::vector<std::string> multiples(10, "0");
+        for (int q = 1; q < 10; ++q) multiples[q] = add(multiples[q - 1], b);
+
+        // The running remainder is kept without leading zeros; empty means zero
+        std::string quotient(a.size(), '0'), remainder, scratch;
+        remainder.reserve(b.size() + 1);
+        scratch.reserve(b.size() + 1);
+        BIGINT_COUNT_ALLOCATION(quotient.size() + 2 * (b.size() + 1));
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (!remainder.empty() || a[i] != '0') remainder.push_back(a[i]);
+
+            int q = 9;
+            while (q > 0 && compare(multiples[q], remainder) > 0) --q;
+            if (q > 0) {
+                scratch.resize(remainder.size());
+                digitKernels::active().subShifted(remainder.data(), remainder.size(), multiples[q].data(), multiples[q].size(), 0, &scratch[0]);
+                size_t start = scratch.find_first_not_of('0');
+                scratch.erase(0, start == std::string::npos ? scratch.size() : start);
+                std::swap(remainder, scratch);
+            }
+            quotient[i] = char('0' + q);
+        }
+        return { fromDigits(std::move(quotient)), remainder.empty() ? "0" : remainder };
+    }
+
+    // floor(a / 10^n)
+    inline std::string dropDigits(const std::string& a, size_t n) {
+        return a.size() > n ? a.substr(0, a.size() - n) : "0";
+    }
+
+    // Divisors up to this many digits get their reciprocal by long division
+    const size_t reciprocalThreshold = 64;
+
+    // floor(10^2d / b) for a d-digit b. The reciprocal y of the top h = d/2 + 2 digits is right
+    // to about half the digits; one Newton step x = y * 10^k + y * (10^2d - b * y * 10^k) / 10^(2d-k)
+    // doubles that, and the last unit or two are settled against the exact residual. y has only
+    // h digits, so the step needs just the top h + 3 digits of the residual.
+    inline std::string reciprocal(const std::string& b) {
+        size_t d = b.size();
+        std::string scale = "1" + std::string(2 * d, '0');
+        if (d <= reciprocalThreshold) return divMod(scale, b).first;
+
+        size_t high = d / 2 + 2, k = d - high;
+        std::string y = reciprocal(b.substr(0, high));
+        std::string product = multiply(b, y) + std::string(k, '0');
+        size_t guard = 2 * d - k - high - 3;
+        std::string x = y + std::string(k, '0');
+        if (compare(product, scale) <= 0) x = add(x, dropDigits(multiply(y, dropDigits(sub(scale, product), guard)), 2 * d - k - guard));
+        else x = sub(x, dropDigits(multiply(y, dropDigits(sub(product, scale), guard)), 2 * d - k - guard));
+
+        product = multiply(b, x);
+        while (compare(product, scale) > 0) {
+            x = sub(x, "1");
+            product = sub(product, b);
+        }
+        std::string residual = sub(scale, product);
+        while (compare(residual, b) >= 0) {
+            x = add(x, "1");
+            residual = sub(residual, b);
+        }
+        return x;
+    }
+
+    // { a / b, a % b } for a < 10^(2 * b.size()), given r = reciprocal(b). The estimate from
+    // the top d + 2 digits of a, (a / 10^(d-2)) * r / 10^(d+2), is never above the quotient
+    // and at most three below it.
+    inline std::pair<std::string, std::string> divModReciprocal(const std::string& a, const std::string& b, const std::string& r) {
+        size_t d = b.size(), low = d > 2 ? d - 2 : 0;
+        std::string quotient = dropDigits(multiply(dropDigits(a, low), r), 2 * d - low);
+        std::string remainder = sub(a, multiply(quotient, b));
+        while (compare(remainder, b) >= 0) {
+            quotient = add(quotient, "1");
+            remainder = sub(remainder, b);
+        }
+        return { quotient, remainder };
+    }
+}
+
+// Conversion between decimal magnitudes and digit strings in other bases (2..36). Decimal is
+// a plain copy; other bases go through divide and conquer over base^(leaf * 2^i), where a
+// leaf is the longest run of digits whose value still fits in 64 bits. Formatting divides by
+// those powers through their reciprocals, so both directions run at multiplication speed.
+namespace radix {
+    const char digitChars[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+    // Powers below this many decimal digits are divided by long division, which is faster
+    // until the multiplications behind a reciprocal division get long
+    size_t newtonDivisionThreshold = 16000;
+
+    // Value of a digit character in any base up to 36, or 36 for anything else
+    inline int digitValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'z') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'Z') return c - 'A' + 10;
+        return 36;
+    }
+
+    inline size_t leafDigits(int base) {
+        size_t digits = 0;
+        for (uint64_t power = 1; power <= UINT64_MAX / base; power *= base) ++digits;
+        return digits;
+    }
+
+    // powers[i] = base^(leaf * 2^i) in decimal, extended by squaring up to `level`
+    inline void extendPowers(std::vector<std::string>& powers, int base, size_t leaf, size_t level) {
+        if (powers.empty()) {
+            uint64_t power = 1;
+            for (size_t i = 0; i < leaf; ++i) power *= base;
+            powers.push_back(std::to_string(power));
+        }
+        while (powers.size() <= level) powers.push_back(magnitude::multiply(powers.back(), powers.back()));
+    }
+
+    // Decimal magnitude of the n valid base-`base` digits at `first`; the low part of each
+    // split is the largest leaf * 2^i digits shorter than n, so every level reuses one power
+    inline std::string parseDigits(const char* first, size_t n, int base, size_t leaf, std::vector<std::string>& powers) {
+        if (n <= leaf) {
+            uint64_t value = 0;
+            for (size_t i = 0; i < n; ++i) value = value * base + digitValue(first[i]);
+            return std::to_string(value);
+        }
+        size_t level = 0;
+        while ((leaf << (level + 1)) < n) ++level;
+        size_t low = leaf << level;
+        extendPowers(powers, base, leaf, level);
+        std::string high = parseDigits(first, n - low, base, leaf, powers);
+        std::string lowValue = parseDigits(first + n - low, low, base, leaf, powers);
+        return magnitude::add(magnitude::multiply(high, powers[level]), lowValue);
+    }
+
+    inline std::string parse(const char* first, size_t n, int base) {
+        while (n > 1 && *first == '0') {
+            ++first;
+            --n;
+        }
+        if (base == 10) return std::string(first, n);
+
+        std::vector<std::string> powers;
+        return parseDigits(first, n, base, leafDigits(base), powers);
+    }
+
+    // Writes the base-`base` digits of decimal magnitude `value` right to left, ending at `end`
+    // and zero-padded on the left to `width` digits (width 0 means no padding). Returns where
+    // the digits start, or nullptr if they would run below `begin`.
+    inline char* formatDigits(const std::string& value, int base, size_t width, size_t leaf, const std::vector<std::string>& powers,
+                              const std::vector<std::string>& reciprocals, const char* begin, char* end) {
+        char* out = end;
+        if (magnitude::compare(value, powers[0]) < 0) {
+            uint64_t rest = std::stoull(value);
+            do {
+                if (out == begin) return nullptr;
+                *--out = digitChars[rest % base];
+                rest /= base;
+            } while (rest != 0);
+            while (size_t(end - out) < width) {
+                if (out == begin) return nullptr;
+                *--out = '0';
+            }
+            return out;
+        }
+        size_t level = reciprocals.size() - 1;
+        while (magnitude::compare(value, powers[level]) < 0) --level;
+        size_t low = leaf << level;
+        if (size_t(end - begin) <= low) return nullptr;
+        std::pair<std::string, std::string> split = reciprocals[level].empty() ? magnitude::divMod(value, powers[level])
+            : magnitude::divModReciprocal(value, powers[level], reciprocals[level]);
+        formatDigits(split.second, base, low, leaf, powers, reciprocals, begin, end);
+        return formatDigits(split.first, base, width > low ? width - low : 0, leaf, powers, reciprocals, begin, end - low);
+    }
+
+    // Writes the digits of decimal magnitude `value` right-aligned in [first, last) and returns
+    // where they start, or nullptr if they do not fit
+    inline char* format(const std::string& value, int base, char* first, char* last) {
+        if (base == 10) {
+            if (size_t(last - first) < value.size()) return nullptr;
+            return static_cast<char*>(std::memcpy(last - value.size(), value.data(), value.size()));
+        }
+
+        // Powers until the square of the last exceeds the value; each one up to the value is a
+        // divisor and gets its reciprocal once it is long enough
+        size_t leaf = leafDigits(base);
+        std::vector<std::string> powers, reciprocals;
+        extendPowers(powers, base, leaf, 0);
+        while (powers.back().size() <= value.size() / 2 + 1) extendPowers(powers, base, leaf, powers.size());
+        for (const std::string& power : powers) {
+            bool divisor = power.size() >= newtonDivisionThreshold && magnitude::compare(value, power) >= 0;
+            reciprocals.push_back(divisor ? magnitude::reciprocal(power) : std::string());
+        }
+        return formatDigits(value, base, 0, leaf, powers, reciprocals, first, last);
+    }
+}
+
+// Decimal magnitudes as 32-bit binary words (least significant first, no zero top word), for
+// the bit operations. Both directions move 9 decimal digits per pass over the words.
+namespace binary {
+    typedef std::vector<uint32_t> Words;
+    const uint32_t decimalChunk = 1000000000;
+
+    inline Words fromDecimal(const std::string& digits) {
+        Words words;
+        size_t chunkLength = (digits.size() - 1) % 9 + 1;
+        for (size_t pos = 0; pos < digits.size(); pos += chunkLength, chunkLength = 9) {
+            uint64_t carry = 0, scale = 1;
+            for (size_t i = pos; i < pos + chunkLength; ++i) {
+                carry = carry * 10 + uint64_t(digits[i] - '0');
+                scale *= 10;
+            }
+            for (uint32_t& word : words) {
+                uint64_t current = uint64_t(word) * scale + carry;
+                word = uint32_t(current);
+                carry = current >> 32;
+            }
+            if (carry != 0) words.push_back(uint32_t(carry));
+        }
+        return words;
+    }
+
+    inline std::string toDecimal(Words words) {
+        while (!words.empty() && words.back() == 0) words.pop_back();
+        if (words.empty()) return "0";
+
+        std::vector<uint32_t> chunks;
+        while (!words.empty()) {
+            uint64_t remainder = 0;
+            for (size_t i = words.size(); i-- > 0;) {
+                uint64_t current = (remainder << 32) | words[i];
+                words[i] = uint32_t(current / decimalChunk);
+                remainder = current % decimalChunk;
+            }
+            chunks.push_back(uint32_t(remainder));
+            while (!words.empty() && words.back() == 0) words.pop_back();
+        }
+
+        std::string result = std::to_string(chunks.back());
+        for (size_t i = chunks.size() - 1; i-- > 0;) {
+            std::string chunk = std::to_string(chunks[i]);
+            result.append(9 - chunk.size(), '0').append(chunk);
+        }
+        return result;
+    }
+
+    inline unsigned popcount(uint32_t word) {
+        word = word - ((word >> 1) & 0x55555555u);
+        word = (word & 0x33333333u) + ((word >> 2) & 0x33333333u);
+        return (((word + (word >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24;
+    }
+
+    inline unsigned countTrailingZeros(uint64_t word) {
+        unsigned count = 0;
+        for (; (word & 0xFFFF) == 0; word >>= 16) count += 16;
+        for (; (word & 1) == 0; word >>= 1) ++count;
+        return count;
+    }
+
+    inline Words shiftLeft(const Words& words, size_t n) {
+        Words result(words.size() + n / 32 + 1, 0);
+        unsigned bits = n % 32;
+        for (size_t i = 0; i < words.size(); ++i) {
+            uint64_t shifted = uint64_t(words[i]) << bits;
+            result[i + n / 32] |= uint32_t(shifted);
+            result[i + n / 32 + 1] |= uint32_t(shifted >> 32);
+        }
+        return result;
+    }
+
+    inline Words shiftRight(const Words& words, size_t n) {
+        if (n / 32 >= words.size()) return Words();
+        Words result(words.size() - n / 32, 0);
+        unsigned bits = n % 32;
+        for (size_t i = 0; i < result.size(); ++i) {
+            uint64_t pair = words[i + n / 32];
+            if (i + n / 32 + 1 < words.size()) pair |= uint64_t(words[i + n / 32 + 1]) << 32;
+            result[i] = uint32_t(pair >> bits);
+        }
+        return result;
+    }
+
+    // Word-wise a op b, with the shorter operand zero-extended
+    template <typename Op>
+    inline Words combine(const Words& a, const Words& b, Op op) {
+        Words result(std::max(a.size(), b.size()));
+        for (size_t i = 0; i < result.size(); ++i) {
+            result[i] = op(i < a.size() ? a[i] : 0u, i < b.size() ? b[i] : 0u);
+        }
+        return result;
+    }
+}
 
 class BigInt {
 private:
     std::string value;
     bool isNegative;
 
+    // Three-way comparison of the absolute values
+    int compareMagnitude(const BigInt& other) const {
+        return magnitude::compare(value, other.value);
+    }
+
+    ScratchInt scratch() const {
+        return { DigitView{ value.data(), value.size() }.trimmed(), isNegative };
+    }
+
+    static BigInt fromScratch(ScratchInt v) {
+        return fromDigits(std::string(v.magnitude.digits, v.magnitude.size), v.negative);
+    }
+
+    template <typename Op>
+    BigInt bitwise(const BigInt& other, Op op) const {
+        binary::Words words = binary::combine(binary::fromDecimal(value), binary::fromDecimal(other.value), op);
+        return fromDigits(binary::toDecimal(std::move(words)), false);
+    }
+
 public:
     bool isLessThan(const BigInt& other) const {
         if (isNegative != other.isNegative) return isNegative;
 
-        if (value.length() != other.value.length()) {
-            return (value.length() < other.value.length()) ^ isNegative;
-        }
-
-        return (value < other.value) ^ isNegative;
+        return (compareMagnitude(other) < 0) ^ isNegative;
     }
 
-    // Constructor to initialize BigInt from string
-    BigInt(std::string val) {
-        if (val[0] == '-') {
-            isNegative = true;
-            value = val.substr(1);
+    // Constructors from an optional '-' followed by decimal digits; the digits are copied once,
+    // straight into the value. Anything else throws std::invalid_argument.
+    BigInt(std::string_view val) : BigInt() {
+        const char* last = val.data() + val.size();
+        std::from_chars_result parsed = from_chars(val.data(), last, *this, 10);
+        if (parsed.ec != std::errc() || parsed.ptr != last) {
+            throw std::invalid_argument("Not a decimal integer: \"" + std::string(val) + "\"");
         }
-        else {
-            isNegative = false;
-            value = val;
-        }
-        value = removeLeadingZeros(value);
     }
 
+    BigInt(const std::string& val) : BigInt(std::string_view(val)) {}
+    BigInt(const char* val) : BigInt(std::string_view(val)) {}
+
     BigInt() : value("0"), isNegative(false) {}
 
+    // Build a BigInt from an unsigned digit string and a sign, stripping leading zeros in place
+    static BigInt fromDigits(std::string digits, bool negative) {
+        BigInt result;
+        size_t start = digits.find_first_not_of('0');
+        if (start == std::string::npos) return result;
+        digits.erase(0, start);
+        result.value = std::move(digits);
+        result.isNegative = negative;
+        return result;
+    }
+
     // Helper function to remove leading zeros
     static std::string removeLeadingZeros(const std::string& str) {
         size_t start = str.find_first_not_of('0');
@@ -45,9 +1441,63 @@ public:
     const std::string& getValue() const { return value; }
     bool getIsNegative() const { return isNegative; }
 
+    // Content hash: multiply-xorshift mixing over 8-digit words of the magnitude, plus the sign
+    size_t hash() const {
+        uint64_t h = 0x9E3779B97F4A7C15ULL ^ value.size() ^ (isNegative ? 0xFF51AFD7ED558CCDULL : 0);
+        auto mix = [&h](uint64_t word) {
+            h = (h ^ word) * 0xBF58476D1CE4E5B9ULL;
+            h ^= h >> 31;
+        };
+        size_t i = 0;
+        for (; i + 8 <= value.size(); i += 8) {
+            uint64_t word;
+            std::memcpy(&word, value.data() + i, 8);
+            mix(word);
+        }
+        uint64_t tail = 0;
+        std::memcpy(&tail, value.data() + i, value.size() - i);
+        mix(tail);
+        return size_t(h ^ (h >> 29));
+    }
+
+    // Decimal shift: *this * 10^n (the binary shift is operator<<)
     BigInt shiftLeft(int n) const {
         if (value == "0") return *this;
-        return BigInt(value + std::string(n, '0'));
+        std::string digits;
+        digits.reserve(value.size() + n);
+        digits.append(value).append(n, '0');
+        return fromDigits(std::move(digits), isNegative);
+    }
+
+    // Computes *this + other * 10^n without materialising the shifted copy of `other`
+    BigInt shiftAdd(const BigInt& other, int n) const {
+        if (other.value == "0") return *this;
+        if (value != "0" && isNegative != other.isNegative) return *this + other.shiftLeft(n);
+
+        return fromDigits(magnitude::addShifted(value, other.value, n), other.isNegative);
+    }
+
+    // *this + other * factor and *this - other * factor in one pass over the digits, for
+    // factors below 2^36
+    BigInt addMul(const BigInt& other, uint64_t factor) const {
+        ScratchArena arena(value.size() + other.value.size() + 64);
+        return fromScratch(scratchMath::addMul(arena, scratch(), other.scratch(), static_cast<long long>(factor)));
+    }
+
+    BigInt subMul(const BigInt& other, uint64_t factor) const {
+        ScratchArena arena(value.size() + other.value.size() + 64);
+        return fromScratch(scratchMath::addMul(arena, scratch(), other.scratch(), -static_cast<long long>(factor)));
+    }
+
+    BigInt mulSmall(uint64_t factor) const {
+        return BigInt().addMul(*this, factor);
+    }
+
+    // *this / divisor for a divisor below 2^36 that is known to divide *this exactly; the
+    // remainder is never computed, so an inexact division gives a meaningless result
+    BigInt divExactSmall(uint64_t divisor) const {
+        ScratchArena arena(4 * value.size() + 64);
+        return fromScratch(scratchMath::divExactSmall(arena, scratch(), static_cast<long long>(divisor)));
     }
 
     // Get a substring of the BigInt value for use in Karatsuba
@@ -61,7 +1511,78 @@ public:
         }
 
         // Return the BigInt created from the specified substring
-        return BigInt(value.substr(start, length));
+        return BigInt(std::string_view(value).substr(start, length));
+    }
+
+    // Bit operations act on the absolute value: shifts keep the sign, &, | and ^ are non-negative.
+    // 10^k is a multiple of 2^k, so the low bits come straight from the last decimal digits and
+    // shifts of up to 60 bits are one multiply or divide pass; everything else goes through
+    // 32-bit binary words.
+
+    // |*this| mod 2^count, for count <= 19
+    uint64_t lowBits(unsigned count) const {
+        size_t digits = std::min<size_t>(count, value.size());
+        uint64_t tail = 0;
+        for (size_t i = value.size() - digits; i < value.size(); ++i) tail = tail * 10 + uint64_t(value[i] - '0');
+        return count == 0 ? 0 : tail & (~0ULL >> (64 - count));
+    }
+
+    bool bit(size_t i) const {
+        if (i < 19) return (lowBits(unsigned(i) + 1) >> i) & 1;
+        binary::Words words = binary::fromDecimal(value);
+        return i / 32 < words.size() && ((words[i / 32] >> (i % 32)) & 1);
+    }
+
+    // Number of bits of |*this|, 0 for zero
+    size_t bitLength() const {
+        if (value == "0") return 0;
+        binary::Words words = binary::fromDecimal(value);
+        size_t length = 32 * words.size();
+        for (uint32_t top = words.back(); (top & 0x80000000u) == 0; top <<= 1) --length;
+        return length;
+    }
+
+    size_t popcount() const {
+        size_t count = 0;
+        for (uint32_t word : binary::fromDecimal(value)) count += binary::popcount(word);
+        return count;
+    }
+
+    // Exponent of the largest power of two dividing *this, 0 for zero
+    size_t countTrailingZeros() const {
+        if (value == "0") return 0;
+        uint64_t low = lowBits(19);
+        if (low != 0) return binary::countTrailingZeros(low);
+
+        binary::Words words = binary::fromDecimal(value);
+        size_t zeroWords = 0;
+        while (words[zeroWords] == 0) ++zeroWords;
+        return 32 * zeroWords + binary::countTrailingZeros(words[zeroWords]);
+    }
+
+    BigInt operator<<(size_t n) const {
+        if (value == "0" || n == 0) return *this;
+        if (n <= 60) return fromDigits(magnitude::mulSmall(value, 1ULL << n), isNegative);
+        return fromDigits(binary::toDecimal(binary::shiftLeft(binary::fromDecimal(value), n)), isNegative);
+    }
+
+    // Truncates towards zero, like the division operator
+    BigInt operator>>(size_t n) const {
+        if (value == "0" || n == 0) return *this;
+        if (n <= 60) return fromDigits(magnitude::divSmall(value, 1ULL << n).first, isNegative);
+        return fromDigits(binary::toDecimal(binary::shiftRight(binary::fromDecimal(value), n)), isNegative);
+    }
+
+    BigInt operator&(const BigInt& other) const {
+        return bitwise(other, [](uint32_t a, uint32_t b) { return a & b; });
+    }
+
+    BigInt operator|(const BigInt& other) const {
+        return bitwise(other, [](uint32_t a, uint32_t b) { return a | b; });
+    }
+
+    BigInt operator^(const BigInt& other) const {
+        return bitwise(other, [](uint32_t a, uint32_t b) { return a ^ b; });
     }
 
     bool operator!=(const BigInt& other) const {
@@ -70,27 +1591,16 @@ public:
 
     // Addition of two BigInts
     BigInt operator+(const BigInt& other) const {
+        BIGINT_COUNT_OPERATION(Add, value.size(), other.value.size());
         if (isNegative == other.isNegative) {
-            std::string result;
-            int carry = 0, sum = 0;
-            int i = value.size() - 1, j = other.value.size() - 1;
-
-            while (i >= 0 || j >= 0 || carry) {
-                int digit1 = i >= 0 ? value[i--] - '0' : 0;
-                int digit2 = j >= 0 ? other.value[j--] - '0' : 0;
-                sum = digit1 + digit2 + carry;
-                carry = sum / 10;
-                result.push_back(sum % 10 + '0');
-            }
-            if (isNegative) result.push_back('-');
-            std::reverse(result.begin(), result.end());
-            return BigInt(result);
+            return fromDigits(magnitude::add(value, other.value), isNegative);
         }
         return *this - (-other);
     }
 
     // Subtraction of two BigInts
     BigInt operator-(const BigInt& other) const {
+        BIGINT_COUNT_OPERATION(Subtract, value.size(), other.value.size());
         // Case 1: If the signs are different, convert to addition
         if (other.value == "0") {
             return *this;
@@ -126,36 +1636,7 @@ public:
 
         // Case 5: Perform actual subtraction when both numbers have the same sign
         // and `*this` has a larger or equal absolute value
-        std::string result;
-        int borrow = 0, diff = 0;
-        int i = value.size() - 1, j = other.value.size() - 1;
-
-        while (i >= 0 || j >= 0 || borrow) {
-            int digit1 = i >= 0 ? value[i--] - '0' : 0;
-            int digit2 = j >= 0 ? other.value[j--] - '0' : 0;
-            diff = digit1 - digit2 - borrow;
-
-            if (diff < 0) {
-                diff += 10;
-                borrow = 1;
-            }
-            else {
-                borrow = 0;
-            }
-
-            result.push_back(diff + '0');
-        }
-
-        // Remove leading zeros and reverse the result
-        std::reverse(result.begin(), result.end());
-        result = removeLeadingZeros(result);
-
-        // Ensure the result sign is correct
-        if (isNegative && !(result == "0")) {
-            result.insert(result.begin(), '-');
-        }
-
-        return BigInt(result);
+        return fromDigits(magnitude::sub(value, other.value), isNegative);
     }
 
 
@@ -169,72 +1650,24 @@ public:
 
     // Multiplication of two BigInts
     BigInt operator*(const BigInt& other) const {
-        BigInt product("0");
-        for (int i = other.value.size() - 1; i >= 0; --i) {
-            int carry = 0;
-            std::string current;
-            for (int k = 0; k < other.value.size() - 1 - i; ++k) current.push_back('0');
-
-            for (int j = value.size() - 1; j >= 0 || carry; --j) {
-                int digit1 = j >= 0 ? value[j] - '0' : 0;
-                int digit2 = other.value[i] - '0';
-                int mul = digit1 * digit2 + carry;
-                carry = mul / 10;
-                current.push_back(mul % 10 + '0');
-            }
-            std::reverse(current.begin(), current.end());
-            product = product + BigInt(current);
-        }
-        product.isNegative = isNegative != other.isNegative;
-        return product;
+        BIGINT_COUNT_OPERATION(Multiply, value.size(), other.value.size());
+        return fromDigits(magnitude::multiply(value, other.value), isNegative != other.isNegative);
     }
 
     BigInt operator/(const BigInt& other) const {
+        BIGINT_COUNT_OPERATION(Divide, value.size(), other.value.size());
         if (other.value == "0") throw std::runtime_error("Division by zero!");
 
-        BigInt dividend = *this;
-        BigInt divisor = other;
-        BigInt quotient("0");
-        BigInt one("1");
-
-        dividend.isNegative = divisor.isNegative = false;
-
-        // Optimized division using repeated subtraction
-        if (dividend.isLessThan(divisor)) {
-            return BigInt("0");
-        }
-
-        while (!dividend.isLessThan(divisor)) {
-            BigInt currentDivisor = divisor;
-            BigInt currentQuotient("1");
-
-            while (!dividend.isLessThan(currentDivisor.shiftLeft(1))) {
-                currentDivisor = currentDivisor.shiftLeft(1);
-                currentQuotient = currentQuotient.shiftLeft(1);
-            }
-
-            dividend = dividend - currentDivisor;
-            quotient = quotient + currentQuotient;
-        }
-
-        quotient.isNegative = isNegative != other.isNegative;
-        return quotient;
+        // Truncating division: the quotient of the magnitudes with the combined sign
+        return fromDigits(magnitude::divMod(value, other.value).first, isNegative != other.isNegative);
     }
 
-    // Modulus operator
+    // Modulus operator (remainder of the absolute values)
     BigInt operator%(const BigInt& other) const {
+        BIGINT_COUNT_OPERATION(Modulo, value.size(), other.value.size());
         if (other.value == "0") throw std::runtime_error("Modulo by zero!");
 
-        BigInt dividend = *this;
-        BigInt divisor = other;
-        dividend.isNegative = divisor.isNegative = false;
-
-        // Using the division result to calculate remainder more efficiently
-        BigInt quotient = dividend / divisor;
-
-        BigInt remainder = dividend - (quotient * divisor);
-
-        return remainder.isNegative ? -remainder : remainder;
+        return fromDigits(magnitude::divMod(value, other.value).second, false);
     }
 
     // Division-assignment operator
@@ -247,6 +1680,55 @@ public:
 
 
 
+    // Like std::from_chars: an optional '-' and at least one digit in `base` (2..36, letters in
+    // either case). On success `result` is set and ptr points past the last digit, otherwise
+    // ec is std::errc::invalid_argument, ptr is `first` and `result` is unchanged.
+    friend std::from_chars_result from_chars(const char* first, const char* last, BigInt& result, int base = 10) {
+        const char* digits = first;
+        bool negative = digits != last && *digits == '-';
+        if (negative) ++digits;
+        const char* end = digits;
+        if (base == 10) {
+            while (end != last && unsigned(*end - '0') < 10) ++end;
+        }
+        else {
+            while (end != last && radix::digitValue(*end) < base) ++end;
+        }
+        if (end == digits) return { first, std::errc::invalid_argument };
+
+        result = fromDigits(radix::parse(digits, end - digits, base), negative);
+        return { end, std::errc() };
+    }
+
+    // Like std::to_chars: writes the value in `base` (2..36, lowercase letters) to
+    // [first, last) without a terminator; ec is std::errc::value_too_large and ptr is `last`
+    // if it does not fit. Decimal output is copied straight from the value; other bases are
+    // written right to left within the first maxChars(base) bytes and then moved down.
+    friend std::to_chars_result to_chars(char* first, char* last, const BigInt& value, int base = 10) {
+        bool sign = value.isNegative && value.value != "0";
+        if (base == 10) {
+            if (size_t(last - first) < sign + value.value.size()) return { last, std::errc::value_too_large };
+            if (sign) *first++ = '-';
+            std::memcpy(first, value.value.data(), value.value.size());
+            return { first + value.value.size(), std::errc() };
+        }
+
+        if (size_t(last - first) <= size_t(sign)) return { last, std::errc::value_too_large };
+        char* end = first + std::min(size_t(last - first), value.maxChars(base));
+        char* digits = radix::format(value.value, base, first + sign, end);
+        if (digits == nullptr) return { last, std::errc::value_too_large };
+
+        if (sign) *first++ = '-';
+        std::memmove(first, digits, end - digits);
+        return { first + (end - digits), std::errc() };
+    }
+
+    // Buffer size that always suffices for to_chars in `base`
+    size_t maxChars(int base = 10) const {
+        if (base == 10) return value.size() + 1;
+        return size_t(std::ceil(value.size() * std::log(10.0) / std::log(double(base)))) + 2;
+    }
+
     // Overload stream output
     friend std::ostream& operator<<(std::ostream& os, const BigInt& bigint) {
         if (bigint.isNegative && bigint.value != "0") os << "-";
@@ -267,13 +1749,7 @@ public:
 
         // If both are positive, compare absolute values normally
         // If both are negative, reverse the comparison
-        bool result;
-        if (value.length() != other.value.length()) {
-            result = value.length() < other.value.length();
-        }
-        else {
-            result = value < other.value;
-        }
+        bool result = compareMagnitude(other) < 0;
 
         return isNegative ? !result : result;  // Invert result if both are negative
     }
@@ -285,125 +1761,75 @@ public:
 
         // If both are positive, compare absolute values normally
         // If both are negative, reverse the comparison
-        bool result;
-        if (value.length() != other.value.length()) {
-            result = value.length() > other.value.length();
-        }
-        else {
-            result = value > other.value;
-        }
+        bool result = compareMagnitude(other) > 0;
 
         return isNegative ? !result : result;  // Invert result if both are negative
     }
 };
 
 
+namespace std {
+    template <>
+    struct hash<BigInt> {
+        size_t operator()(const BigInt& n) const { return n.hash(); }
+    };
+}
+
 class BigNat {
 private:
-    std::string value; // Store the big integer as a string to handle large sizes
-
-    // Helper function to remove leading zeros
-    static std::string removeLeadingZeros(const std::string& str) {
-        size_t start = str.find_first_not_of('0');
-        if (start == std::string::npos) return "0";
-        return str.substr(start);
-    }
+    std::string value; // Unsigned magnitude, all arithmetic goes through the shared magnitude engine
 
     // Helper function to check if this BigNat is less than another
     bool isLessThan(const BigNat& other) const {
-        if (value.length() != other.value.length()) {
-            return value.length() < other.value.length();
-        }
-        return value < other.value;
+        return magnitude::compare(value, other.value) < 0;
     }
 
 public:
     // Constructor to initialize BigNat from string
-    BigNat(std::string val) : value(removeLeadingZeros(val)) {}
+    BigNat(std::string val) : value(magnitude::fromDigits(std::move(val))) {}
 
     // Constructor to initialize BigNat from integer
     BigNat(int val) : value(std::to_string(val)) {}
 
+    const std::string& getValue() const { return value; }
+
     // Addition of two BigNats
     BigNat operator+(const BigNat& other) const {
-        std::string result;
-        int carry = 0, sum = 0;
-        int i = value.size() - 1, j = other.value.size() - 1;
-
-        while (i >= 0 || j >= 0 || carry) {
-            int digit1 = i >= 0 ? value[i--] - '0' : 0;
-            int digit2 = j >= 0 ? other.value[j--] - '0' : 0;
-            sum = digit1 + digit2 + carry;
-            carry = sum / 10;
-            result.push_back(sum % 10 + '0');
-        }
-
-        std::reverse(result.begin(), result.end());
-        return BigNat(result);
+        return BigNat(magnitude::add(value, other.value));
     }
 
     // Subtraction of two BigNats (assuming *this >= other)
     BigNat operator-(const BigNat& other) const {
         if (isLessThan(other)) throw std::invalid_argument("Result would be negative");
 
-        std::string result;
-        int borrow = 0, diff = 0;
-        int i = value.size() - 1, j = other.value.size() - 1;
-
-        while (i >= 0 || j >= 0 || borrow) {
-            int digit1 = i >= 0 ? value[i--] - '0' : 0;
-            int digit2 = j >= 0 ? other.value[j--] - '0' : 0;
-            diff = digit1 - digit2 - borrow;
-            if (diff < 0) {
-                diff += 10;
-                borrow = 1;
-            }
-            else {
-                borrow = 0;
-            }
-            result.push_back(diff + '0');
-        }
-
-        std::reverse(result.begin(), result.end());
-        return BigNat(removeLeadingZeros(result));
+        return BigNat(magnitude::sub(value, other.value));
     }
 
     // Multiplication of two BigNats
     BigNat operator*(const BigNat& other) const {
-        BigNat product("0");
-        for (int i = other.value.size() - 1; i >= 0; --i) {
-            int carry = 0;
-            std::string current;
-            for (int k = 0; k < other.value.size() - 1 - i; ++k) current.push_back('0');
-
-            for (int j = value.size() - 1; j >= 0 || carry; --j) {
-                int digit1 = j >= 0 ? value[j] - '0' : 0;
-                int digit2 = other.value[i] - '0';
-                int mul = digit1 * digit2 + carry;
-                carry = mul / 10;
-                current.push_back(mul % 10 + '0');
-            }
-            std::reverse(current.begin(), current.end());
-            product = product + BigNat(current);
-        }
-        return product;
+        return BigNat(magnitude::multiply(value, other.value));
     }
 
     // Division of two BigNats (integer division)
     BigNat operator/(const BigNat& other) const {
         if (other.value == "0") throw std::runtime_error("Division by zero!");
 
-        BigNat dividend = *this;
-        BigNat divisor = other;
-        BigNat quotient("0");
-        BigNat one("1");
+        return BigNat(magnitude::divMod(value, other.value).first);
+    }
+
+    // Remainder of the integer division
+    BigNat operator%(const BigNat& other) const {
+        if (other.value == "0") throw std::runtime_error("Modulo by zero!");
 
-        while (!dividend.isLessThan(divisor)) {
-            dividend = dividend - divisor;
-            quotient = quotient + one;
-        }
+        return BigNat(magnitude::divMod(value, other.value).second);
+    }
 
-        return quotient;
+    bool operator==(const BigNat& other) const {
+        return value == other.value;
+    }
+
+    bool operator<(const BigNat& other) const {
+        return isLessThan(other);
     }
 
     // Overload stream output for easy display
@@ -413,6 +1839,287 @@ public:
     }
 };
 
+// Calls f(0), f(1), ..., f(N - 1) as N straight-line calls, so the carry chains over a
+// fixed number of words compile without a loop. Past unrollLimit words the compiler stops
+// inlining the calls and the plain loop is faster (2x at 1024 bits).
+const size_t unrollLimit = 24;
+
+template <typename F, size_t... I>
+constexpr void unrolled(F&& f, std::index_sequence<I...>) {
+    (f(I), ...);
+}
+
+template <size_t N, typename F>
+constexpr void unrolled(F&& f) {
+    if constexpr (N <= unrollLimit) {
+        unrolled(f, std::make_index_sequence<N>());
+    } else {
+        for (size_t i = 0; i < N; ++i) f(i);
+    }
+}
+
+// Unsigned integer of a fixed width in 32-bit words kept on the stack, least significant first,
+// for values with a known bound such as 256- to 4096-bit moduli. Arithmetic wraps modulo 2^Bits
+// like the built-in unsigned types; everything but the BigInt conversions is constexpr.
+template <size_t Bits>
+class BigUInt {
+    static_assert(Bits >= 64 && Bits % 32 == 0, "BigUInt width must be a multiple of 32 bits, at least 64");
+
+public:
+    static constexpr size_t Words = Bits / 32;
+    typedef std::array<uint32_t, Words> Limbs;
+
+    constexpr BigUInt(uint64_t value = 0) : limbs{} {
+        limbs[0] = uint32_t(value);
+        limbs[1] = uint32_t(value >> 32);
+    }
+
+    constexpr explicit BigUInt(const Limbs& limbs) : limbs(limbs) {}
+
+    // Zero-extends or truncates a BigUInt of another width
+    template <size_t OtherBits>
+    constexpr explicit BigUInt(const BigUInt<OtherBits>& other) : limbs{} {
+        for (size_t i = 0; i < Words && i < BigUInt<OtherBits>::Words; ++i) limbs[i] = other.getLimbs()[i];
+    }
+
+    // Throws std::overflow_error for negative values and values wider than Bits
+    explicit BigUInt(const BigInt& value) : limbs{} {
+        if (value.getIsNegative()) throw std::overflow_error("Negative value does not fit in BigUInt");
+
+        binary::Words words = binary::fromDecimal(value.getValue());
+        while (!words.empty() && words.back() == 0) words.pop_back();
+        if (words.size() > Words) throw std::overflow_error("Value does not fit in BigUInt");
+        std::copy(words.begin(), words.end(), limbs.begin());
+    }
+
+    BigInt toBigInt() const {
+        return BigInt::fromDigits(binary::toDecimal(binary::Words(limbs.begin(), limbs.end())), false);
+    }
+
+    constexpr const Limbs& getLimbs() const { return limbs; }
+
+    constexpr bool isZero() const {
+        for (uint32_t limb : limbs) if (limb != 0) return false;
+        return true;
+    }
+
+    constexpr bool bit(size_t i) const {
+        return i < Bits && ((limbs[i / 32] >> (i % 32)) & 1) != 0;
+    }
+
+    constexpr size_t bitLength() const {
+        for (size_t i = Words; i-- > 0;) {
+            if (limbs[i] == 0) continue;
+            size_t length = 32 * i;
+            for (uint32_t limb = limbs[i]; limb != 0; limb >>= 1) ++length;
+            return length;
+        }
+        return 0;
+    }
+
+    constexpr BigUInt operator+(const BigUInt& other) const {
+        BigUInt result;
+        uint64_t carry = 0;
+        unrolled<Words>([&](size_t i) {
+            uint64_t current = uint64_t(limbs[i]) + other.limbs[i] + carry;
+            result.limbs[i] = uint32_t(current);
+            carry = current >> 32;
+        });
+        return result;
+    }
+
+    constexpr BigUInt operator-(const BigUInt& other) const {
+        BigUInt result;
+        uint64_t borrow = 0;
+        unrolled<Words>([&](size_t i) {
+            uint64_t current = uint64_t(limbs[i]) - other.limbs[i] - borrow;
+            result.limbs[i] = uint32_t(current);
+            borrow = current >> 63;
+        });
+        return result;
+    }
+
+    // Two's complement, 2^Bits - *this
+    constexpr BigUInt operator-() const {
+        return BigUInt() - *this;
+    }
+
+    // Low Bits bits of the product; each row's carry chain is unrolled
+    constexpr BigUInt operator*(const BigUInt& other) const {
+        BigUInt result;
+        for (size_t i = 0; i < Words; ++i) {
+            uint64_t carry = 0;
+            unrolled<Words>([&](size_t j) {
+                if (i + j >= Words) return;
+                uint64_t current = uint64_t(limbs[i]) * other.limbs[j] + result.limbs[i + j] + carry;
+                result.limbs[i + j] = uint32_t(current);
+                carry = current >> 32;
+            });
+        }
+        return result;
+    }
+
+    constexpr BigUInt operator/(const BigUInt& other) const {
+        return divMod(*this, other).first;
+    }
+
+    constexpr BigUInt operator%(const BigUInt& other) const {
+        return divMod(*this, other).second;
+    }
+
+    constexpr BigUInt operator<<(size_t n) const {
+        BigUInt result;
+        if (n >= Bits) return result;
+        size_t wordShift = n / 32, bitShift = n % 32;
+        for (size_t i = Words; i-- > wordShift;) {
+            uint32_t low = (bitShift != 0 && i > wordShift) ? limbs[i - wordShift - 1] >> (32 - bitShift) : 0;
+            result.limbs[i] = (limbs[i - wordShift] << bitShift) | low;
+        }
+        return result;
+    }
+
+    constexpr BigUInt operator>>(size_t n) const {
+        BigUInt result;
+        if (n >= Bits) return result;
+        size_t wordShift = n / 32, bitShift = n % 32;
+        for (size_t i = 0; i + wordShift < Words; ++i) {
+            uint32_t high = (bitShift != 0 && i + wordShift + 1 < Words) ? limbs[i + wordShift + 1] << (32 - bitShift) : 0;
+            result.limbs[i] = (limbs[i + wordShift] >> bitShift) | high;
+        }
+        return result;
+    }
+
+    constexpr BigUInt& operator+=(const BigUInt& other) { return *this = *this + other; }
+    constexpr BigUInt& operator-=(const BigUInt& other) { return *this = *this - other; }
+    constexpr BigUInt& operator*=(const BigUInt& other) { return *this = *this * other; }
+    constexpr BigUInt& operator/=(const BigUInt& other) { return *this = *this / other; }
+    constexpr BigUInt& operator%=(const BigUInt& other) { return *this = *this % other; }
+    constexpr BigUInt& operator<<=(size_t n) { return *this = *this << n; }
+    constexpr BigUInt& operator>>=(size_t n) { return *this = *this >> n; }
+
+    constexpr bool operator==(const BigUInt& other) const {
+        for (size_t i = 0; i < Words; ++i) if (limbs[i] != other.limbs[i]) return false;
+        return true;
+    }
+
+    constexpr bool operator<(const BigUInt& other) const {
+        for (size_t i = Words; i-- > 0;) {
+            if (limbs[i] != other.limbs[i]) return limbs[i] < other.limbs[i];
+        }
+        return false;
+    }
+
+    constexpr bool operator!=(const BigUInt& other) const { return !(*this == other); }
+    constexpr bool operator>(const BigUInt& other) const { return other < *this; }
+    constexpr bool operator<=(const BigUInt& other) const { return !(other < *this); }
+    constexpr bool operator>=(const BigUInt& other) const { return !(*this < other); }
+
+    // Binary long division, one quotient bit per step
+    static constexpr std::pair<BigUInt, BigUInt> divMod(const BigUInt& a, const BigUInt& b) {
+        if (b.isZero()) throw std::runtime_error("Division by zero!");
+
+        BigUInt quotient, remainder;
+        for (size_t i = a.bitLength(); i-- > 0;) {
+            // remainder < b, so when the doubling carries out of the top word it is already >= b
+            bool carry = remainder.bit(Bits - 1);
+            remainder <<= 1;
+            remainder.limbs[0] |= uint32_t(a.bit(i));
+            if (carry || !(remainder < b)) {
+                remainder -= b;
+                quotient.limbs[i / 32] |= uint32_t(1) << (i % 32);
+            }
+        }
+        return { quotient, remainder };
+    }
+
+    // Montgomery arithmetic modulo an odd n: residues are kept as a * 2^Bits mod n and
+    // multiplied with the reduction interleaved (CIOS), all on the stack
+    class Montgomery {
+    public:
+        constexpr explicit Montgomery(const BigUInt& modulus) : n(modulus), nPrime(0), unit(), rSquared() {
+            if (!modulus.bit(0)) throw std::invalid_argument("Montgomery modulus must be odd");
+
+            // -n^-1 mod 2^32 by Newton iteration, every step doubles the number of correct bits
+            uint32_t inverse = 1;
+            for (int i = 0; i < 5; ++i) inverse *= 2 - modulus.limbs[0] * inverse;
+            nPrime = 0u - inverse;
+
+            // 2^Bits and 2^(2 Bits) mod n by repeated doubling, no wide division needed
+            BigUInt r = BigUInt(1) % n;
+            for (size_t i = 0; i < 2 * Bits; ++i) {
+                bool carry = r.bit(Bits - 1);
+                r <<= 1;
+                if (carry || !(r < n)) r -= n;
+                if (i == Bits - 1) unit = r;
+            }
+            rSquared = r;
+        }
+
+        constexpr const BigUInt& getModulus() const { return n; }
+        constexpr const BigUInt& one() const { return unit; }
+
+        constexpr BigUInt toMontgomery(const BigUInt& a) const { return multiply(a % n, rSquared); }
+        constexpr BigUInt fromMontgomery(const BigUInt& a) const { return multiply(a, BigUInt(1)); }
+
+        // a * b / 2^Bits mod n
+        constexpr BigUInt multiply(const BigUInt& a, const BigUInt& b) const {
+            std::array<uint32_t, Words + 2> t{};
+            for (size_t i = 0; i < Words; ++i) {
+                uint64_t carry = 0;
+                unrolled<Words>([&](size_t j) {
+                    uint64_t current = uint64_t(t[j]) + uint64_t(a.limbs[j]) * b.limbs[i] + carry;
+                    t[j] = uint32_t(current);
+                    carry = current >> 32;
+                });
+                uint64_t current = uint64_t(t[Words]) + carry;
+                t[Words] = uint32_t(current);
+                t[Words + 1] = uint32_t(current >> 32);
+
+                // Adding m * n clears the low word, which is then shifted out
+                uint32_t m = t[0] * nPrime;
+                carry = (uint64_t(t[0]) + uint64_t(m) * n.limbs[0]) >> 32;
+                unrolled<Words - 1>([&](size_t j) {
+                    uint64_t value = uint64_t(t[j + 1]) + uint64_t(m) * n.limbs[j + 1] + carry;
+                    t[j] = uint32_t(value);
+                    carry = value >> 32;
+                });
+                current = uint64_t(t[Words]) + carry;
+                t[Words - 1] = uint32_t(current);
+                t[Words] = t[Words + 1] + uint32_t(current >> 32);
+            }
+
+            BigUInt result;
+            for (size_t j = 0; j < Words; ++j) result.limbs[j] = t[j];
+            if (t[Words] != 0 || !(result < n)) result -= n;
+            return result;
+        }
+
+        // base^exponent mod n, taking and returning ordinary residues
+        constexpr BigUInt power(const BigUInt& base, const BigUInt& exponent) const {
+            BigUInt x = toMontgomery(base), result = unit;
+            for (size_t i = exponent.bitLength(); i-- > 0;) {
+                result = multiply(result, result);
+                if (exponent.bit(i)) result = multiply(result, x);
+            }
+            return fromMontgomery(result);
+        }
+
+    private:
+        BigUInt n;
+        uint32_t nPrime;
+        BigUInt unit;
+        BigUInt rSquared;
+    };
+
+    friend std::ostream& operator<<(std::ostream& os, const BigUInt& value) {
+        os << value.toBigInt();
+        return os;
+    }
+
+private:
+    Limbs limbs;
+};
+
 BigInt gcd(const BigInt& a, const BigInt& b) {
     BigInt absA = a.getIsNegative() ? -a : a;
     BigInt absB = b.getIsNegative() ? -b : b;
@@ -442,6 +2149,32 @@ private:
         }
     }
 
+    // Unreduced numerator/denominator pair used while binary splitting
+    struct Fraction {
+        BigInt numerator;
+        BigInt denominator;
+    };
+
+    // Splits [first, first + count) in halves and combines them without reducing, so every level
+    // multiplies operands of similar size (which is where karatsuba/Toom pay off)
+    template <typename Iterator>
+    static Fraction splitSum(Iterator first, size_t count) {
+        if (count == 1) return { first->numerator, first->denominator };
+        size_t half = count / 2;
+        Fraction left = splitSum(first, half);
+        Fraction right = splitSum(std::next(first, half), count - half);
+        return { left.numerator * right.denominator + right.numerator * left.denominator, left.denominator * right.denominator };
+    }
+
+    template <typename Iterator>
+    static Fraction splitProduct(Iterator first, size_t count) {
+        if (count == 1) return { first->numerator, first->denominator };
+        size_t half = count / 2;
+        Fraction left = splitProduct(first, half);
+        Fraction right = splitProduct(std::next(first, half), count - half);
+        return { left.numerator * right.numerator, left.denominator * right.denominator };
+    }
+
 public:
     BigRational(const BigInt& num, const BigInt& den) : numerator(num), denominator(den) {
         if (den.getValue() == "0") {
@@ -475,12 +2208,40 @@ public:
         return BigRational(newNumerator, newDenominator);
     }
 
+    // Sum of a range of rationals by balanced binary splitting; reduce() runs once on the result
+    template <typename Iterator>
+    static BigRational sum(Iterator first, Iterator last) {
+        size_t count = std::distance(first, last);
+        if (count == 0) return BigRational(BigInt("0"), BigInt("1"));
+        Fraction total = splitSum(first, count);
+        return BigRational(total.numerator, total.denominator);
+    }
+
+    // Product of a range of rationals by balanced binary splitting; reduce() runs once on the result
+    template <typename Iterator>
+    static BigRational product(Iterator first, Iterator last) {
+        size_t count = std::distance(first, last);
+        if (count == 0) return BigRational(BigInt("1"), BigInt("1"));
+        Fraction total = splitProduct(first, count);
+        return BigRational(total.numerator, total.denominator);
+    }
+
     friend std::ostream& operator<<(std::ostream& os, const BigRational& bigrat) {
         os << bigrat.numerator << "/" << bigrat.denominator;
         return os;
     }
 };
 
+template <typename Range>
+BigRational sum(const Range& terms) {
+    return BigRational::sum(std::begin(terms), std::end(terms));
+}
+
+template <typename Range>
+BigRational product(const Range& terms) {
+    return BigRational::product(std::begin(terms), std::end(terms));
+}
+
 template <typename T>
 T gcd(T a, T b) {
     while (b != T(0)) {
@@ -558,259 +2319,26 @@ public:
     T getDenominator() const { return denominator; }
 };
 
-BigInt karatsuba(const BigInt& x, const BigInt& y) {
-    bool isXNegative = x.getIsNegative();
-    bool isYNegative = y.getIsNegative();
-
-    // Base case: if either number is a single digit
-    if (x.getValue().size() == 1 || y.getValue().size() == 1) {
-        return x * y;
-    }
-
-    // Make strings the same length by padding with zeros if necessary
-    int n = std::max(x.getValue().size(), y.getValue().size());
-    int half = n / 2;
-
-    BigInt x1 = x.getSubBigInt(0, x.getValue().size() - half);  // High part of x
-    BigInt x0 = x.getSubBigInt(x.getValue().size() - half);    // Low part of x
-    BigInt y1 = y.getSubBigInt(0, y.getValue().size() - half);  // High part of y
-    BigInt y0 = y.getSubBigInt(y.getValue().size() - half);    // Low part of y
-
-    // Recursively calculate three products
-    BigInt z2 = karatsuba(x1, y1);
-    BigInt z0 = karatsuba(x0, y0);
-    BigInt z1 = karatsuba(x1 + x0, y1 + y0) - z2 - z0;
-
-    // Shift z2 and z1 appropriately
-    z2 = z2.shiftLeft(2 * half);
-    z1 = z1.shiftLeft(half);
-
-    // Combine results
-    BigInt result = z2 + z1 + z0;
-
-    // Logic to remove half zeros if either x or y is smaller than half
-    if (x.getValue().size() < half || y.getValue().size() < half) {
-        int zerosToRemove = half;  // Calculate half of `half`
-        std::string resultValue = result.getValue();
-        size_t length = resultValue.size();
-
-        // Remove zeros if present at the end of the result
-        size_t nonZeroPos = resultValue.find_last_not_of('0');
-        if (nonZeroPos != std::string::npos && length - nonZeroPos - 1 >= zerosToRemove) {
-            resultValue.erase(length - zerosToRemove);
-        }
-
-        result = BigInt(resultValue); // Update the result with trimmed value
-    }
-
-    if (isXNegative != isYNegative) {
-        result = -result;
-    }
+// Runs one of the digit-level algorithms on a whole product with a single scratch arena
+BigInt multiplyWith(const BigInt& x, const BigInt& y, DigitMultiplier algorithm) {
+    const std::string& a = x.getValue();
+    const std::string& b = y.getValue();
+    ScratchArena arena(ScratchArena::bytesForMultiply(a.size(), b.size()));
+    std::string product(a.size() + b.size(), '0');
+    multiplyInto({ a.data(), a.size() }, { b.data(), b.size() }, &product[0], arena, algorithm);
+    return BigInt::fromDigits(std::move(product), x.getIsNegative() != y.getIsNegative());
+}
 
-    return result;
+BigInt karatsuba(const BigInt& x, const BigInt& y) {
+    return multiplyWith(x, y, karatsubaDigits);
 }
 
 BigInt toom3Multiply(const BigInt& a, const BigInt& b) {
-    // Step 1: Check signs
-    bool isANegative = a.getIsNegative();
-    bool isBNegative = b.getIsNegative();
-
-    // Convert `a` and `b` to positive for the multiplication if they are negative
-    BigInt absA = isANegative ? -a : a;
-    BigInt absB = isBNegative ? -b : b;
-
-    int n = std::max(absA.getValue().size(), absB.getValue().size());
-    int m = std::min(absA.getValue().size(), absB.getValue().size());
-    if (m <= 3) {
-        BigInt result = absA * absB;
-        return isANegative != isBNegative ? -result : result;  // Adjust sign for small inputs
-    }
-
-    // Determine part sizes
-    int baseSize = n / 3;
-    int remainder = n % 3;
-    int partSize2a = baseSize;
-    int partSize3a = baseSize;
-    int partSize2b = baseSize;
-    int partSize3b = baseSize;
-    if (remainder > 0) partSize2a++;
-    if (remainder > 0) partSize3a++;
-    if (remainder > 0) partSize2b++;
-    if (remainder > 0) partSize3b++;
-    int partSize1a = std::max(0, static_cast<int>(absA.getValue().size()) - 2 * partSize2a);
-    //std::cout << "partsize1a: " << partSize1a << std::endl;
-    int partSize1b = std::max(0, static_cast<int>(absB.getValue().size()) - 2 * partSize2b);
-    //std::cout << "partsize1b: " << partSize1b << std::endl;
-    if (partSize1a == 0) {
-        partSize2a = std::max(0, static_cast<int>(absA.getValue().size() - partSize2a));
-    }
-    if (partSize1b == 0) {
-        partSize2b = std::max(0, static_cast<int>(absB.getValue().size() - partSize2b));
-    }
-    //std::cout << "partsize2b: " << partSize2b << std::endl;
-    // Split `a` and `b` into parts
-    BigInt a0 = absA.getSubBigInt(partSize1a + partSize2a, partSize3a);
-    //std::cout << "a0: " << a0 << std::endl;
-    BigInt a1 = absA.getSubBigInt(partSize1a, partSize2a);
-    //std::cout << "a1: " << a1 << std::endl;
-    BigInt a2 = absA.getSubBigInt(0, partSize1a);
-    //std::cout << "a2: " << a2 << std::endl;
-    BigInt b0 = (partSize1b + partSize2b <= absB.getValue().size()) ? absB.getSubBigInt(partSize1b + partSize2b, partSize3b) : BigInt("0");
-    //std::cout << "b0: " << b0 << std::endl;
-    BigInt b1 = (partSize1b <= absB.getValue().size()) ? absB.getSubBigInt(partSize1b, partSize2b) : BigInt("0");
-    //std::cout << "b1: " << b1 << std::endl;
-    BigInt b2 = absB.getSubBigInt(0, partSize1b);
-    //std::cout << "b2: " << b2 << std::endl;
-    // Evaluate polynomials
-    BigInt p0 = a0;
-    //std::cout << "p0: " << p0 << std::endl;
-    BigInt p1 = a0 + a1 + a2;
-    //std::cout << "p1: " << p1 << std::endl;
-    BigInt p2 = (a0 - a1) + a2;
-    //std::cout << "p2: " << p2 << std::endl;
-    BigInt p3 = a0 - (BigInt("2") * a1) + (BigInt("4") * a2);
-    //std::cout << "p3: " << p3 << std::endl;
-    BigInt p4 = a2;
-    //std::cout << "p4: " << p4 << std::endl;
-
-    BigInt q0 = b0;
-    //std::cout << "q0: " << q0 << std::endl;
-    BigInt q1 = b0 + b1 + b2;
-    //std::cout << "q1: " << q1 << std::endl;
-    BigInt q2 = b0 - b1 + b2;
-    //std::cout << "q2: " << q2 << std::endl;
-    BigInt q3 = b0 - (BigInt("2") * b1) + (BigInt("4") * b2);
-    //std::cout << "q3: " << q3 << std::endl;
-    BigInt q4 = b2;
-    //std::cout << "q4: " << q4 << std::endl;
-
-    // Recursive multiplications
-    BigInt r0 = toom3Multiply(p0, q0);
-    BigInt r1 = toom3Multiply(p1, q1);
-    BigInt r2 = toom3Multiply(p2, q2);
-    BigInt r3 = toom3Multiply(p3, q3);
-    BigInt r4 = toom3Multiply(p4, q4);
-
-    BigInt r00 = r0;
-    //std::cout << "r00: " << r00 << std::endl;
-    BigInt r04 = r4;
-    //std::cout << "r04: " << r04 << std::endl;
-    BigInt r03 = (r3 - r1) / BigInt("3");
-    //std::cout << "r03: " << r03 << std::endl;
-    BigInt r01 = (r1 - r2) / BigInt("2");
-    //std::cout << "r01: " << r01 << std::endl;
-    BigInt r02 = (r2 - r0);
-    //std::cout << "r02: " << r02 << std::endl;
-
-    r03 = ((r02 - r03) / BigInt("2")) + (BigInt("2") * r04);
-    //std::cout << "r03 (refined): " << r03 << std::endl;
-    r02 = r02 + r01 - r04;
-    //std::cout << "r02 (refined): " << r02 << std::endl;
-    r01 = r01 - r03;
-    //std::cout << "r01 (refined): " << r01 << std::endl;
-
-    BigInt result = r00
-        + (r01.shiftLeft(partSize3a))
-        + (r02.shiftLeft(2 * partSize3a))
-        + (r03.shiftLeft(3 * partSize3a))
-        + (r04.shiftLeft(4 * partSize3a));
-    //std::cout << "result: " << result << std::endl;
-
-    // Adjust sign based on original signs of `a` and `b`
-    if (isANegative != isBNegative) {
-        result = -result;
-    }
-
-    return result;
+    return multiplyWith(a, b, toom3Digits);
 }
 
-
 BigInt toom5Multiply(const BigInt& a, const BigInt& b) {
-    // Step 1: Check signs
-    bool isANegative = a.getIsNegative();
-    bool isBNegative = b.getIsNegative();
-
-    // Convert `a` and `b` to positive for the multiplication if they are negative
-    BigInt absA = isANegative ? -a : a;
-    BigInt absB = isBNegative ? -b : b;
-
-    int n = std::max(absA.getValue().size(), absB.getValue().size());
-    int m = std::min(absA.getValue().size(), absB.getValue().size());
-    if (m <= 3) {
-        BigInt result = absA * absB;
-        return isANegative != isBNegative ? -result : result;  // Adjust sign for small inputs
-    }
-
-    // Determine part sizes
-    int baseSize = n / 5;
-    int remainder = n % 5;
-
-    // Calculate individual part sizes
-    int partSize4 = baseSize + (remainder > 0 ? 1 : 0);
-    int partSize3 = baseSize + (remainder > 1 ? 1 : 0);
-    int partSize2 = baseSize + (remainder > 2 ? 1 : 0);
-    int partSize1 = baseSize + (remainder > 3 ? 1 : 0);
-    int partSize0 = absA.getValue().size() - 4 * baseSize;
-
-    // Split `a` and `b` into five parts
-    BigInt a0 = absA.getSubBigInt(partSize1 + partSize2 + partSize3 + partSize4, partSize0);
-    BigInt a1 = absA.getSubBigInt(partSize2 + partSize3 + partSize4, partSize1);
-    BigInt a2 = absA.getSubBigInt(partSize3 + partSize4, partSize2);
-    BigInt a3 = absA.getSubBigInt(partSize4, partSize3);
-    BigInt a4 = absA.getSubBigInt(0, partSize4);
-
-    BigInt b0 = absB.getSubBigInt(partSize1 + partSize2 + partSize3 + partSize4, partSize0);
-    BigInt b1 = absB.getSubBigInt(partSize2 + partSize3 + partSize4, partSize1);
-    BigInt b2 = absB.getSubBigInt(partSize3 + partSize4, partSize2);
-    BigInt b3 = absB.getSubBigInt(partSize4, partSize3);
-    BigInt b4 = absB.getSubBigInt(0, partSize4);
-
-    // Evaluate polynomials at points 0, 1, -1, -2, 2, ∞ (for five points)
-    BigInt p0 = a0;
-    BigInt p1 = a0 + a1 + a2 + a3 + a4;
-    BigInt p2 = a0 - a1 + a2 - a3 + a4;
-    BigInt p3 = a0 + (BigInt("2") * a1) + (BigInt("4") * a2) + (BigInt("8") * a3) + (BigInt("16") * a4);
-    BigInt p4 = a0 - (BigInt("2") * a1) + (BigInt("4") * a2) - (BigInt("8") * a3) + (BigInt("16") * a4);
-    BigInt p5 = a4;
-
-    BigInt q0 = b0;
-    BigInt q1 = b0 + b1 + b2 + b3 + b4;
-    BigInt q2 = b0 - b1 + b2 - b3 + b4;
-    BigInt q3 = b0 + (BigInt("2") * b1) + (BigInt("4") * b2) + (BigInt("8") * b3) + (BigInt("16") * b4);
-    BigInt q4 = b0 - (BigInt("2") * b1) + (BigInt("4") * b2) - (BigInt("8") * b3) + (BigInt("16") * b4);
-    BigInt q5 = b4;
-
-    // Recursive multiplications at each evaluated point
-    BigInt r0 = toom5Multiply(p0, q0);
-    BigInt r1 = toom5Multiply(p1, q1);
-    BigInt r2 = toom5Multiply(p2, q2);
-    BigInt r3 = toom5Multiply(p3, q3);
-    BigInt r4 = toom5Multiply(p4, q4);
-    BigInt r5 = toom5Multiply(p5, q5);
-
-    // Interpolate and combine results
-    // Interpolation involves solving a system to get final coefficients for result.
-    BigInt r00 = r0;
-    BigInt r05 = r5;
-    BigInt r04 = (r4 - r1) / BigInt("3");
-    BigInt r03 = (r3 - r2) / BigInt("3");
-    BigInt r02 = (r2 - r0) / BigInt("2");
-    BigInt r01 = (r1 - r3) / BigInt("2");
-
-    // Combine coefficients to form the final result
-    BigInt result = r00
-        + (r01.shiftLeft(partSize1))
-        + (r02.shiftLeft(2 * partSize1))
-        + (r03.shiftLeft(3 * partSize1))
-        + (r04.shiftLeft(4 * partSize1))
-        + (r05.shiftLeft(5 * partSize1));
-
-    // Adjust sign based on original signs of `a` and `b`
-    if (isANegative != isBNegative) {
-        result = -result;
-    }
-
-    return result;
+    return multiplyWith(a, b, toom5Digits);
 }
 
 
@@ -818,36 +2346,53 @@ BigInt power(BigInt a, BigInt b, const BigInt& mod) {
     BigInt result("1");
     a = a % mod;
     while (b != BigInt("0")) {
-        if ((b % BigInt("2")) != BigInt("0")) {
+        if (b.bit(0)) {
             result = (result * a) % mod;
         }
         a = (a * a) % mod;
-        b = b / BigInt("2");
+        b = b >> 1;
+    }
+    return result;
+}
+
+// Fixed-width modular power without heap allocation: Montgomery for an odd modulus, otherwise
+// square-and-multiply with the products taken at double width so they cannot wrap
+template <size_t Bits>
+BigUInt<Bits> power(BigUInt<Bits> a, BigUInt<Bits> b, const BigUInt<Bits>& mod) {
+    if (mod.bit(0)) return typename BigUInt<Bits>::Montgomery(mod).power(a, b);
+
+    typedef BigUInt<2 * Bits> Wide;
+    const Wide wideMod(mod);
+    BigUInt<Bits> result(1);
+    a %= mod;
+    for (size_t i = 0, length = b.bitLength(); i < length; ++i) {
+        if (b.bit(i)) result = BigUInt<Bits>(Wide(result) * Wide(a) % wideMod);
+        a = BigUInt<Bits>(Wide(a) * Wide(a) % wideMod);
     }
     return result;
 }
 
 // Function to compute the Jacobi symbol (a/n)
 int jacobi(const BigInt& a, const BigInt& n) {
-    if (n.getIsNegative() || n == BigInt("0") || n % BigInt("2") == BigInt("0")) return 0;
+    if (n.getIsNegative() || n == BigInt("0") || !n.bit(0)) return 0;
 
     BigInt A = a, N = n;
     int result = 1;
 
     if (A.getIsNegative()) {
         A = -A;
-        if (N % BigInt("4") == BigInt("3")) result = -result;
+        if (N.lowBits(2) == 3) result = -result;
     }
 
     while (A != BigInt("0")) {
-        while (A % BigInt("2") == BigInt("0")) {
-            A = A / BigInt("2");
-            if (N % BigInt("8") == BigInt("3") || N % BigInt("8") == BigInt("5")) {
-                result = -result;
-            }
+        // (2/N) = -1 exactly when N is 3 or 5 mod 8, so only the parity of the twos matters
+        size_t twos = A.countTrailingZeros();
+        A = A >> twos;
+        if (twos % 2 == 1 && (N.lowBits(3) == 3 || N.lowBits(3) == 5)) {
+            result = -result;
         }
         std::swap(A, N);
-        if (A % BigInt("4") == BigInt("3") && N % BigInt("4") == BigInt("3")) {
+        if (A.lowBits(2) == 3 && N.lowBits(2) == 3) {
             result = -result;
         }
         A = A % N;
@@ -855,22 +2400,40 @@ int jacobi(const BigInt& a, const BigInt& n) {
     return (N == BigInt("1")) ? result : 0;
 }
 
+// Per-thread engine for the randomized tests, so concurrent callers never share generator state
+std::mt19937_64& threadRng() {
+    thread_local std::mt19937_64 rng(std::random_device{}());
+    return rng;
+}
+
+// Uniform-ish random BigInt in [min, max]
+BigInt randomBigInt(const BigInt& min, const BigInt& max, std::mt19937_64& rng) {
+    // A few digits more than max keeps the modulo bias negligible
+    std::string randomStr(max.getValue().size() + 8, '0');
+    for (char& digit : randomStr) {
+        digit = char('0' + rng() % 10);
+    }
+    return min + BigInt(randomStr) % (max - min + BigInt("1"));
+}
+
+BigInt randomBigInt(const BigInt& min, const BigInt& max) {
+    return randomBigInt(min, max, threadRng());
+}
+
 // Solovay–Strassen primality test using BigInt
-bool isPrime(const BigInt& n, int k = 5) {
+bool isPrime(const BigInt& n, int k, std::mt19937_64& rng) {
     if (n < BigInt("2")) return false;
-    if (n == BigInt("2")) return true;
-    if (n % BigInt("2") == BigInt("0")) return false;
-
-    srand(time(0));
+    if (n == BigInt("2") || n == BigInt("3")) return true;
+    if (!n.bit(0)) return false;
 
     for (int i = 0; i < k; ++i) {
         // Generate a random BigInt a such that 2 <= a <= n - 2
-        BigInt a = BigInt("2") + (BigInt(std::to_string(rand())) % (n - BigInt("3")));
+        BigInt a = BigInt("2") + (BigInt(std::to_string(rng())) % (n - BigInt("3")));
 
         int jacobian = jacobi(a, n);  // Compute Jacobi symbol (a/n)
         if (jacobian == 0) return false;
 
-        BigInt mod = power(a, (n - BigInt("1")) / BigInt("2"), n);
+        BigInt mod = power(a, (n - BigInt("1")) >> 1, n);
 
         // Compare mod with jacobian result as BigInt
         BigInt jacobianMod = (jacobian == -1) ? n - BigInt("1") : BigInt(std::to_string(jacobian));
@@ -880,30 +2443,21 @@ bool isPrime(const BigInt& n, int k = 5) {
     return true;
 }
 
-BigInt randomBigInt(const BigInt& min, const BigInt& max) {
-    std::string randomStr;
-    size_t len = max.getValue().size();
-    for (size_t i = 0; i < len; ++i) {
-        randomStr += std::to_string(rand() % 10);  // Simple random digit
-    }
-    BigInt randNum(randomStr);
-    return randNum.isLessThan(min) ? min : randNum;
+bool isPrime(const BigInt& n, int k = 5) {
+    return isPrime(n, k, threadRng());
 }
 
-bool millerRabin(const BigInt& n, int k = 5) {
+bool millerRabin(const BigInt& n, int k, std::mt19937_64& rng) {
     if (n == BigInt("1") || n == BigInt("0")) return false;
     if (n == BigInt("2") || n == BigInt("3")) return true;
-    if (n % BigInt("2") == BigInt("0")) return false;
+    if (!n.bit(0)) return false;
 
     BigInt d = n - BigInt("1");
-    int r = 0;
-    while (d % BigInt("2") == BigInt("0")) {
-        d /= BigInt("2");
-        r++;
-    }
+    int r = int(d.countTrailingZeros());
+    d = d >> r;
 
     for (int i = 0; i < k; i++) {
-        BigInt a = randomBigInt(BigInt("2"), n - BigInt("2"));
+        BigInt a = randomBigInt(BigInt("2"), n - BigInt("2"), rng);
         BigInt x = power(a, d, n);  // Calculate a^d % n
 
         if (x == BigInt("1") || x == n - BigInt("1")) continue;
@@ -921,6 +2475,52 @@ bool millerRabin(const BigInt& n, int k = 5) {
     return true;
 }
 
+bool millerRabin(const BigInt& n, int k = 5) {
+    return millerRabin(n, k, threadRng());
+}
+
+// Miller–Rabin on a fixed-width value, squaring in Montgomery form throughout
+template <size_t Bits>
+bool millerRabin(const BigUInt<Bits>& n, int k, std::mt19937_64& rng) {
+    typedef BigUInt<Bits> Value;
+    if (n < Value(4)) return n == Value(2) || n == Value(3);
+    if (!n.bit(0)) return false;
+
+    const Value nMinusOne = n - Value(1);
+    size_t r = 0;
+    while (!nMinusOne.bit(r)) ++r;
+    const Value d = nMinusOne >> r;
+
+    const typename Value::Montgomery field(n);
+    const Value minusOne = field.toMontgomery(nMinusOne);
+
+    for (int i = 0; i < k; i++) {
+        // A random base 2 <= a <= n - 2
+        typename Value::Limbs limbs{};
+        for (uint32_t& limb : limbs) limb = uint32_t(rng());
+        Value a = Value(limbs) % (n - Value(3)) + Value(2);
+
+        Value x = field.toMontgomery(field.power(a, d));
+        if (x == field.one() || x == minusOne) continue;
+
+        bool found = false;
+        for (size_t j = 1; j < r; j++) {
+            x = field.multiply(x, x);
+            if (x == minusOne) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) return false;
+    }
+    return true;
+}
+
+template <size_t Bits>
+bool millerRabin(const BigUInt<Bits>& n, int k = 5) {
+    return millerRabin(n, k, threadRng());
+}
+
 
 BigInt modularExponentiation(const BigInt& base, const BigInt& exp) {
     BigInt result("1");
@@ -928,11 +2528,11 @@ BigInt modularExponentiation(const BigInt& base, const BigInt& exp) {
     BigInt exponent = exp;
 
     while (exponent > BigInt("0")) {
-        if (exponent % BigInt("2") == BigInt("1")) {
+        if (exponent.bit(0)) {
             result = result * current_base;
         }
         current_base = current_base * current_base;
-        exponent = exponent / BigInt("2");
+        exponent = exponent >> 1;
     }
 
     return result;
@@ -963,6 +2563,941 @@ bool lucasLehmerTest(const BigInt& p) {
     return s == BigInt("0");
 }
 
+// Remainder of a decimal magnitude by a small divisor, in one pass over the digits
+unsigned long long remainderSmall(const std::string& digits, unsigned long long divisor) {
+    unsigned long long remainder = 0;
+    for (char digit : digits) {
+        remainder = (remainder * 10 + (digit - '0')) % divisor;
+    }
+    return remainder;
+}
+
+// Primes below limit, by the sieve of Eratosthenes
+std::vector<unsigned> primesBelow(unsigned limit) {
+    std::vector<unsigned> found;
+    std::vector<bool> composite(limit, false);
+    for (unsigned i = 2; i < limit; ++i) {
+        if (composite[i]) continue;
+        found.push_back(i);
+        for (unsigned long long j = 1ULL * i * i; j < limit; j += i) composite[j] = true;
+    }
+    return found;
+}
+
+// Primes below 1000 for the cheap trial-division pass in front of the randomized tests
+const std::vector<unsigned>& smallPrimes() {
+    static const std::vector<unsigned> primes = primesBelow(1000);
+    return primes;
+}
+
+// Smallest prime below 1000 that divides n, or 0 when there is none
+unsigned smallFactor(const BigInt& n) {
+    for (unsigned p : smallPrimes()) {
+        if (remainderSmall(n.getValue(), p) == 0) return p;
+    }
+    return 0;
+}
+
+// Bounded, thread-safe least-recently-used map from BigInt keys to cached results
+template <typename Value>
+class LruCache {
+public:
+    explicit LruCache(size_t capacity) : capacity(std::max<size_t>(1, capacity)), hitCount(0), missCount(0) {}
+
+    // Looks the key up and marks it as most recently used
+    bool get(const BigInt& key, Value& value) {
+        return get(key, value, [](const Value&) { return true; });
+    }
+
+    // As above, but an entry the predicate rejects (e.g. a stale verdict the caller will recompute)
+    // is reported and counted as a miss
+    template <typename Accept>
+    bool get(const BigInt& key, Value& value, Accept accept) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(key);
+        if (it == index.end() || !accept(it->second->second)) {
+            ++missCount;
+            return false;
+        }
+        entries.splice(entries.begin(), entries, it->second);
+        value = it->second->second;
+        ++hitCount;
+        return true;
+    }
+
+    void put(const BigInt& key, const Value& value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(key);
+        if (it != index.end()) {
+            it->second->second = value;
+            entries.splice(entries.begin(), entries, it->second);
+            return;
+        }
+        entries.emplace_front(key, value);
+        index.emplace(key, entries.begin());
+        if (entries.size() > capacity) {
+            index.erase(entries.back().first);
+            entries.pop_back();
+        }
+    }
+
+    unsigned long long hits() const { return hitCount; }
+    unsigned long long misses() const { return missCount; }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return entries.size();
+    }
+
+private:
+    typedef std::list<std::pair<BigInt, Value>> Entries;
+
+    size_t capacity;
+    mutable std::mutex mutex;
+    Entries entries;
+    std::unordered_map<BigInt, typename Entries::iterator> index;
+    std::atomic<unsigned long long> hitCount;
+    std::atomic<unsigned long long> missCount;
+};
+
+// Memoizing front end for the primality tests and the small-factor search. A composite verdict
+// is final; a probable-prime verdict is reused when it was reached with at least as many rounds.
+class PrimalityCache {
+public:
+    struct Stats {
+        unsigned long long hits;
+        unsigned long long misses;
+        size_t entries;
+    };
+
+    explicit PrimalityCache(size_t capacity = 100000)
+        : millerRabinVerdicts(capacity), solovayStrassenVerdicts(capacity), lucasLehmerVerdicts(capacity), smallFactors(capacity) {}
+
+    bool millerRabin(const BigInt& n, int k, std::mt19937_64& rng) {
+        return cachedTest(millerRabinVerdicts, n, k, [&]() { return ::millerRabin(n, k, rng); });
+    }
+
+    bool millerRabin(const BigInt& n, int k = 5) {
+        return millerRabin(n, k, threadRng());
+    }
+
+    bool isPrime(const BigInt& n, int k, std::mt19937_64& rng) {
+        return cachedTest(solovayStrassenVerdicts, n, k, [&]() { return ::isPrime(n, k, rng); });
+    }
+
+    bool isPrime(const BigInt& n, int k = 5) {
+        return isPrime(n, k, threadRng());
+    }
+
+    bool lucasLehmerTest(const BigInt& p) {
+        bool verdict;
+        if (lucasLehmerVerdicts.get(p, verdict)) return verdict;
+        verdict = ::lucasLehmerTest(p);
+        lucasLehmerVerdicts.put(p, verdict);
+        return verdict;
+    }
+
+    unsigned smallFactor(const BigInt& n) {
+        unsigned factor;
+        if (smallFactors.get(n, factor)) return factor;
+        factor = ::smallFactor(n);
+        smallFactors.put(n, factor);
+        return factor;
+    }
+
+    Stats stats() const {
+        return {
+            millerRabinVerdicts.hits() + solovayStrassenVerdicts.hits() + lucasLehmerVerdicts.hits() + smallFactors.hits(),
+            millerRabinVerdicts.misses() + solovayStrassenVerdicts.misses() + lucasLehmerVerdicts.misses() + smallFactors.misses(),
+            millerRabinVerdicts.size() + solovayStrassenVerdicts.size() + lucasLehmerVerdicts.size() + smallFactors.size()
+        };
+    }
+
+private:
+    struct Verdict {
+        bool probablePrime;
+        int rounds;
+    };
+
+    template <typename Test>
+    static bool cachedTest(LruCache<Verdict>& cache, const BigInt& n, int rounds, Test test) {
+        Verdict cached;
+        auto sufficient = [rounds](const Verdict& v) { return !v.probablePrime || v.rounds >= rounds; };
+        if (cache.get(n, cached, sufficient)) return cached.probablePrime;
+        bool verdict = test();
+        cache.put(n, { verdict, rounds });
+        return verdict;
+    }
+
+    LruCache<Verdict> millerRabinVerdicts;
+    LruCache<Verdict> solovayStrassenVerdicts;
+    LruCache<bool> lucasLehmerVerdicts;
+    LruCache<unsigned> smallFactors;
+};
+
+// Streams candidates (one decimal per line) through a fixed pool of worker threads, each with its
+// own RNG, and writes "<candidate> <verdict>" lines in input order. At most maxInFlight candidates
+// are held between the reader and the writer, so memory stays bounded for inputs of any length.
+class BatchPrimalityTester {
+public:
+    // NotPrime is for 0 and 1, which are neither prime nor composite
+    enum class Verdict { Composite, ProbablePrime, NotPrime, Invalid };
+
+    // Tests of candidates up to a given number of digits; latency[i] counts the tests that took
+    // between 2^i and 2^(i+1) microseconds
+    struct SizeBucket {
+        unsigned long long count = 0;
+        unsigned long long totalNanoseconds = 0;
+        unsigned long long latency[32] = {};
+    };
+
+    struct Report {
+        unsigned long long tested = 0;
+        unsigned long long probablePrimes = 0;
+        unsigned long long composites = 0;
+        unsigned long long notPrime = 0;
+        unsigned long long invalid = 0;
+        unsigned long long decidedByTrialDivision = 0;
+        double seconds = 0;
+        std::map<size_t, SizeBucket> bySize;
+
+        double testsPerSecond() const { return seconds > 0 ? tested / seconds : 0; }
+
+        void merge(const Report& other) {
+            tested += other.tested;
+            probablePrimes += other.probablePrimes;
+            composites += other.composites;
+            notPrime += other.notPrime;
+            invalid += other.invalid;
+            decidedByTrialDivision += other.decidedByTrialDivision;
+            for (const auto& entry : other.bySize) {
+                SizeBucket& bucket = bySize[entry.first];
+                bucket.count += entry.second.count;
+                bucket.totalNanoseconds += entry.second.totalNanoseconds;
+                for (int i = 0; i < 32; ++i) bucket.latency[i] += entry.second.latency[i];
+            }
+        }
+
+        void print(std::ostream& os) const {
+            os << "tested " << tested << " (" << probablePrimes << " probable primes, " << composites << " composites, "
+                << notPrime << " neither, " << invalid << " invalid) in " << seconds << " s: " << testsPerSecond() << " tests/s, "
+                << decidedByTrialDivision << " decided by trial division\n";
+            for (const auto& entry : bySize) {
+                const SizeBucket& bucket = entry.second;
+                os << "  <= " << entry.first << " digits: " << bucket.count << " tests, mean "
+                    << bucket.totalNanoseconds / 1000.0 / bucket.count << " us, latency us:";
+                for (int i = 0; i < 32; ++i) {
+                    if (bucket.latency[i]) os << " [" << (i == 0 ? 0 : 1ULL << i) << "," << (2ULL << i) << "):" << bucket.latency[i];
+                }
+                os << "\n";
+            }
+        }
+    };
+
+    explicit BatchPrimalityTester(unsigned threads = std::thread::hardware_concurrency(), int rounds = 5, size_t maxInFlight = 4096, PrimalityCache* cache = nullptr)
+        : threads(std::max(1u, threads)), rounds(rounds), maxInFlight(std::max<size_t>(1, maxInFlight)), cache(cache) {}
+
+    static const char* verdictName(Verdict verdict) {
+        switch (verdict) {
+        case Verdict::Composite: return "composite";
+        case Verdict::ProbablePrime: return "probable-prime";
+        case Verdict::NotPrime: return "not-prime";
+        default: return "invalid";
+        }
+    }
+
+    // Trial division by the primes below 1000, then Miller-Rabin with the caller's RNG;
+    // both go through the cache when one is given
+    static Verdict test(const std::string& candidate, int rounds, std::mt19937_64& rng, bool& byTrialDivision, PrimalityCache* cache = nullptr) {
+        byTrialDivision = true;
+        BigInt n;
+        const char* last = candidate.data() + candidate.size();
+        std::from_chars_result parsed = from_chars(candidate.data(), last, n);
+        if (parsed.ec != std::errc() || parsed.ptr != last || candidate[0] == '-') return Verdict::Invalid;
+
+        const std::string& digits = n.getValue();
+        unsigned long long small = digits.size() <= 7 ? std::stoull(digits) : 0;
+        if (digits.size() <= 7 && small < 2) return Verdict::NotPrime;
+        unsigned factor = cache ? cache->smallFactor(n) : smallFactor(n);
+        if (factor != 0) return factor == small ? Verdict::ProbablePrime : Verdict::Composite;
+        // No factor below 1000 settles everything below 1000^2
+        if (digits.size() <= 7 && small < 1000000) return Verdict::ProbablePrime;
+
+        byTrialDivision = false;
+        bool probablePrime = cache ? cache->millerRabin(n, rounds, rng) : millerRabin(n, rounds, rng);
+        return probablePrime ? Verdict::ProbablePrime : Verdict::Composite;
+    }
+
+    Report runFile(const std::string& path, std::ostream& out) {
+        std::ifstream in(path);
+        if (!in) throw std::runtime_error("Cannot open " + path);
+        return run(in, out);
+    }
+
+    Report run(std::istream& in, std::ostream& out) {
+        struct Job {
+            size_t sequence;
+            std::string candidate;
+        };
+        struct Result {
+            std::string candidate;
+            Verdict verdict;
+        };
+
+        std::mutex mutex;
+        std::condition_variable workAvailable, progress;
+        std::deque<Job> pending;
+        std::map<size_t, Result> finished;
+        size_t nextRead = 0, nextWrite = 0;
+        bool endOfInput = false;
+        std::vector<Report> partial(threads);
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t]() {
+                std::mt19937_64 rng(std::random_device{}() ^ (0x9E3779B97F4A7C15ULL * (t + 1)));
+                Report& report = partial[t];
+                while (true) {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    workAvailable.wait(lock, [&]() { return !pending.empty() || endOfInput; });
+                    if (pending.empty()) return;
+                    Job job = std::move(pending.front());
+                    pending.pop_front();
+                    lock.unlock();
+
+                    auto begin = std::chrono::steady_clock::now();
+                    bool byTrialDivision = false;
+                    Verdict verdict = test(job.candidate, rounds, rng, byTrialDivision, cache);
+                    unsigned long long elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+                    record(report, job.candidate, verdict, byTrialDivision, elapsed);
+
+                    lock.lock();
+                    finished.emplace(job.sequence, Result{ std::move(job.candidate), verdict });
+                    progress.notify_one();
+                }
+            });
+        }
+
+        // Writes every result that is next in input order; the output itself happens unlocked
+        auto drain = [&](std::unique_lock<std::mutex>& lock) {
+            std::vector<Result> ready;
+            for (auto it = finished.find(nextWrite); it != finished.end(); it = finished.find(nextWrite)) {
+                ready.push_back(std::move(it->second));
+                finished.erase(it);
+                ++nextWrite;
+            }
+            if (ready.empty()) return;
+            lock.unlock();
+            for (const Result& result : ready) {
+                out << result.candidate << ' ' << verdictName(result.verdict) << '\n';
+            }
+            lock.lock();
+        };
+
+        std::string line;
+        while (std::getline(in, line)) {
+            size_t first = line.find_first_not_of(" \t\r");
+            if (first == std::string::npos) continue;
+            size_t last = line.find_last_not_of(" \t\r");
+
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                drain(lock);
+                if (nextRead - nextWrite < maxInFlight) break;
+                progress.wait(lock);
+            }
+            pending.push_back({ nextRead++, line.substr(first, last - first + 1) });
+            workAvailable.notify_one();
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            endOfInput = true;
+            workAvailable.notify_all();
+            while (nextWrite < nextRead) {
+                progress.wait(lock, [&]() { return finished.count(nextWrite) != 0; });
+                drain(lock);
+            }
+        }
+        for (std::thread& worker : workers) worker.join();
+        out.flush();
+
+        Report report;
+        for (const Report& part : partial) report.merge(part);
+        report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return report;
+    }
+
+private:
+    static void record(Report& report, const std::string& candidate, Verdict verdict, bool byTrialDivision, unsigned long long nanoseconds) {
+        ++report.tested;
+        if (verdict == Verdict::ProbablePrime) ++report.probablePrimes;
+        else if (verdict == Verdict::Composite) ++report.composites;
+        else if (verdict == Verdict::NotPrime) ++report.notPrime;
+        else ++report.invalid;
+        if (byTrialDivision && verdict != Verdict::Invalid) ++report.decidedByTrialDivision;
+
+        size_t sizeLimit = 1;
+        while (sizeLimit < candidate.size()) sizeLimit *= 2;
+        SizeBucket& bucket = report.bySize[sizeLimit];
+        ++bucket.count;
+        bucket.totalNanoseconds += nanoseconds;
+        int slot = 0;
+        for (unsigned long long micros = nanoseconds / 1000; micros > 1 && slot < 31; micros >>= 1) ++slot;
+        ++bucket.latency[slot];
+    }
+
+    unsigned threads;
+    int rounds;
+    size_t maxInFlight;
+    PrimalityCache* cache;
+};
+
+// Residues modulo an odd n > 1 as k 32-bit words in Montgomery form (a * 2^(32k) mod n), so the
+// factoring loops multiply without going through decimal long division
+class MontgomeryField {
+public:
+    typedef binary::Words Element;
+
+    explicit MontgomeryField(const BigInt& modulus)
+        : modulus(modulus), n(binary::fromDecimal(modulus.getValue())), k(n.size()) {
+        // -n^-1 mod 2^32 by Newton iteration, every step doubles the number of correct bits
+        uint32_t inverse = 1;
+        for (int i = 0; i < 5; ++i) inverse *= 2 - n[0] * inverse;
+        nPrime = 0u - inverse;
+
+        BigInt r = (BigInt("1") << (32 * k)) % modulus;
+        unit = words(r);
+        rSquared = words(r * r % modulus);
+    }
+
+    const BigInt& getModulus() const { return modulus; }
+    const Element& one() const { return unit; }
+
+    Element fromBigInt(const BigInt& x) const {
+        Element result;
+        mul(words(x % modulus), rSquared, result);
+        return result;
+    }
+
+    BigInt toBigInt(const Element& a) const {
+        Element plain(k, 0), result;
+        plain[0] = 1;
+        mul(a, plain, result);
+        return BigInt::fromDigits(binary::toDecimal(result), false);
+    }
+
+    bool isZero(const Element& a) const {
+        return std::all_of(a.begin(), a.end(), [](uint32_t word) { return word == 0; });
+    }
+
+    // out = a * b / 2^(32k) mod n, interleaving the product and the reduction (CIOS);
+    // out may be a or b
+    void mul(const Element& a, const Element& b, Element& out) const {
+        thread_local std::vector<uint32_t> t;
+        t.assign(k + 2, 0);
+        for (size_t i = 0; i < k; ++i) {
+            uint64_t carry = 0, current;
+            for (size_t j = 0; j < k; ++j) {
+                current = uint64_t(t[j]) + uint64_t(a[j]) * b[i] + carry;
+                t[j] = uint32_t(current);
+                carry = current >> 32;
+            }
+            current = uint64_t(t[k]) + carry;
+            t[k] = uint32_t(current);
+            t[k + 1] = uint32_t(current >> 32);
+
+            // Adding m * n clears the low word, which is then shifted out
+            uint32_t m = t[0] * nPrime;
+            carry = (uint64_t(t[0]) + uint64_t(m) * n[0]) >> 32;
+            for (size_t j = 1; j < k; ++j) {
+                current = uint64_t(t[j]) + uint64_t(m) * n[j] + carry;
+                t[j - 1] = uint32_t(current);
+                carry = current >> 32;
+            }
+            current = uint64_t(t[k]) + carry;
+            t[k - 1] = uint32_t(current);
+            t[k] = t[k + 1] + uint32_t(current >> 32);
+        }
+        out.assign(t.begin(), t.begin() + k);
+        if (t[k] != 0 || !less(out, n)) subtractModulus(out);
+    }
+
+    void add(const Element& a, const Element& b, Element& out) const {
+        out.resize(k);
+        uint64_t carry = 0;
+        for (size_t i = 0; i < k; ++i) {
+            uint64_t current = uint64_t(a[i]) + b[i] + carry;
+            out[i] = uint32_t(current);
+            carry = current >> 32;
+        }
+        if (carry != 0 || !less(out, n)) subtractModulus(out);
+    }
+
+    void sub(const Element& a, const Element& b, Element& out) const {
+        out.resize(k);
+        uint64_t borrow = 0;
+        for (size_t i = 0; i < k; ++i) {
+            uint64_t current = uint64_t(a[i]) - b[i] - borrow;
+            out[i] = uint32_t(current);
+            borrow = current >> 63;
+        }
+        if (borrow != 0) {
+            uint64_t carry = 0;
+            for (size_t i = 0; i < k; ++i) {
+                uint64_t current = uint64_t(out[i]) + n[i] + carry;
+                out[i] = uint32_t(current);
+                carry = current >> 32;
+            }
+        }
+    }
+
+    void power(const Element& a, uint64_t exponent, Element& out) const {
+        Element base = a, result = unit;
+        for (; exponent != 0; exponent >>= 1) {
+            if (exponent & 1) mul(result, base, result);
+            if (exponent > 1) mul(base, base, base);
+        }
+        out = std::move(result);
+    }
+
+private:
+    // x (already below n) as exactly k words
+    Element words(const BigInt& x) const {
+        Element result = binary::fromDecimal(x.getValue());
+        result.resize(k, 0);
+        return result;
+    }
+
+    static bool less(const Element& a, const Element& b) {
+        for (size_t i = a.size(); i-- > 0;) {
+            if (a[i] != b[i]) return a[i] < b[i];
+        }
+        return false;
+    }
+
+    void subtractModulus(Element& a) const {
+        uint64_t borrow = 0;
+        for (size_t i = 0; i < k; ++i) {
+            uint64_t current = uint64_t(a[i]) - n[i] - borrow;
+            a[i] = uint32_t(current);
+            borrow = current >> 63;
+        }
+    }
+
+    BigInt modulus;
+    Element n;
+    size_t k;
+    uint32_t nPrime;
+    Element unit, rSquared;
+};
+
+// x-only arithmetic on the Montgomery curve B y^2 = x^3 + A x^2 + x in projective (X : Z) form,
+// with (A + 2) / 4 = a24 / d24 kept as a fraction so setting up a curve needs no inversion.
+// The temporaries make a curve single-threaded; every ECM worker builds its own.
+class MontgomeryCurve {
+public:
+    typedef MontgomeryField::Element Element;
+
+    struct Point {
+        Element x, z;
+    };
+
+    // Suyama's parametrization: u = sigma^2 - 5, v = 4 sigma, start point (u^3 : v^3) and
+    // (A + 2) / 4 = (v - u)^3 (3u + v) / (16 u^3 v); the group order is divisible by 12
+    MontgomeryCurve(const MontgomeryField& field, uint64_t sigma, Point& start) : field(field) {
+        Element s = field.fromBigInt(BigInt(std::to_string(sigma)));
+        Element five = field.fromBigInt(BigInt("5")), four = field.fromBigInt(BigInt("4"));
+        Element u, v, u3, v3, w;
+        field.mul(s, s, u);
+        field.sub(u, five, u);
+        field.mul(four, s, v);
+        field.mul(u, u, u3);
+        field.mul(u3, u, u3);
+        field.mul(v, v, v3);
+        field.mul(v3, v, v3);
+        start = { u3, v3 };
+
+        field.sub(v, u, w);
+        field.mul(w, w, a24);
+        field.mul(a24, w, a24);
+        field.add(u, u, w);
+        field.add(w, u, w);
+        field.add(w, v, w);
+        field.mul(a24, w, a24);
+        field.mul(four, four, d24);
+        field.mul(d24, u3, d24);
+        field.mul(d24, v, d24);
+    }
+
+    void dbl(const Point& p, Point& out) {
+        field.add(p.x, p.z, t1);
+        field.mul(t1, t1, t1);
+        field.sub(p.x, p.z, t2);
+        field.mul(t2, t2, t2);
+        field.sub(t1, t2, t3);
+        field.mul(d24, t2, t2);
+        field.mul(t1, t2, out.x);
+        field.mul(a24, t3, t1);
+        field.add(t1, t2, t1);
+        field.mul(t3, t1, out.z);
+    }
+
+    // out = p + q, given difference = p - q
+    void add(const Point& p, const Point& q, const Point& difference, Point& out) {
+        field.sub(p.x, p.z, t1);
+        field.add(q.x, q.z, t2);
+        field.mul(t1, t2, t1);
+        field.add(p.x, p.z, t2);
+        field.sub(q.x, q.z, t3);
+        field.mul(t2, t3, t2);
+        field.add(t1, t2, t3);
+        field.sub(t1, t2, t4);
+        field.mul(t3, t3, t3);
+        field.mul(t4, t4, t4);
+        field.mul(difference.z, t3, t3);
+        field.mul(difference.x, t4, out.z);
+        out.x.swap(t3);
+    }
+
+    // Montgomery ladder; the two registers always differ by p
+    void multiply(const Point& p, uint64_t scalar, Point& out) {
+        if (scalar == 1) {
+            out = p;
+            return;
+        }
+        Point r0 = p, r1;
+        dbl(p, r1);
+        int top = 63;
+        while (((scalar >> top) & 1) == 0) --top;
+        for (int bit = top - 1; bit >= 0; --bit) {
+            if ((scalar >> bit) & 1) {
+                add(r1, r0, p, r0);
+                dbl(r1, r1);
+            }
+            else {
+                add(r1, r0, p, r1);
+                dbl(r0, r0);
+            }
+        }
+        out = std::move(r0);
+    }
+
+private:
+    const MontgomeryField& field;
+    Element a24, d24;
+    Element t1, t2, t3, t4;
+};
+
+// Prime factorization by stages of growing cost: trial division, Pollard rho (Brent's cycle
+// detection, one gcd per batch of steps), Pollard p-1 and Lenstra ECM on Montgomery curves, with
+// the ECM curves spread over worker threads. Every split-off part goes through the stages
+// again until Miller-Rabin calls it prime; parts no stage can split are reported as unfactored.
+class Factorizer {
+public:
+    struct Limits {
+        unsigned trialDivisionBound;
+        uint64_t rhoIterations;
+        uint64_t pMinus1B1, pMinus1B2;
+        // How many rows of the ECM schedule to try (2 .. 4 reach 20 .. 30-digit factors)
+        unsigned ecmLevels;
+    };
+
+    static Limits defaultLimits() {
+        return { 65536, 1 << 18, 100000, 5000000, 3 };
+    }
+
+    // Wall-clock seconds per stage; the ECM stages add up the time of all their threads
+    struct Stage {
+        const char* name;
+        double seconds;
+        unsigned splits;
+    };
+
+    struct Result {
+        std::vector<BigInt> factors;     // (probable) primes in ascending order, with multiplicity
+        std::vector<BigInt> unfactored;  // composites that survived every stage
+        std::vector<Stage> stages;
+
+        void print(std::ostream& os) const {
+            for (const Stage& stage : stages) {
+                os << "  " << stage.name << ": " << stage.seconds << " s, " << stage.splits << " splits\n";
+            }
+        }
+    };
+
+    explicit Factorizer(unsigned threads = std::thread::hardware_concurrency())
+        : Factorizer(threads, defaultLimits()) {}
+
+    Factorizer(unsigned threads, const Limits& limits)
+        : threads(std::max(1u, threads)), limits(limits),
+        primes(primesBelow(unsigned(std::max<uint64_t>({ limits.trialDivisionBound, limits.pMinus1B2, ecmSchedule[3].b1 + 1 })))) {}
+
+    Result factor(const BigInt& n) const {
+        Result result;
+        result.stages = { { "trial division", 0, 0 }, { "pollard rho", 0, 0 }, { "pollard p-1", 0, 0 },
+            { "ecm stage 1", 0, 0 }, { "ecm stage 2", 0, 0 } };
+        BigInt rest = n.getIsNegative() ? -n : n;
+        if (rest == BigInt("0")) {
+            result.unfactored.push_back(rest);
+            return result;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned p : primes) {
+            if (p >= limits.trialDivisionBound) break;
+            while (remainderSmall(rest.getValue(), p) == 0) {
+                result.factors.push_back(BigInt(std::to_string(p)));
+                rest = BigInt::fromDigits(magnitude::divSmall(rest.getValue(), p).first, false);
+                ++result.stages[0].splits;
+            }
+        }
+        result.stages[0].seconds = secondsSince(start);
+
+        std::vector<BigInt> pending;
+        if (rest != BigInt("1")) pending.push_back(rest);
+        while (!pending.empty()) {
+            BigInt composite = pending.back();
+            pending.pop_back();
+            if (millerRabin(composite, 25)) {
+                result.factors.push_back(composite);
+                continue;
+            }
+
+            MontgomeryField field(composite);
+            BigInt divisor = split(field, result.stages);
+            if (divisor == BigInt("1")) {
+                result.unfactored.push_back(composite);
+                continue;
+            }
+            pending.push_back(divisor);
+            pending.push_back(composite / divisor);
+        }
+
+        std::sort(result.factors.begin(), result.factors.end(), [](const BigInt& a, const BigInt& b) { return a.isLessThan(b); });
+        return result;
+    }
+
+private:
+    typedef MontgomeryField::Element Element;
+
+    struct EcmLevel {
+        uint64_t b1;
+        unsigned curves;
+    };
+
+    // The usual B1 and curve counts for 15, 20, 25 and 30-digit factors; stage 2 goes to 50 B1
+    static constexpr EcmLevel ecmSchedule[4] = { { 2000, 25 }, { 11000, 90 }, { 50000, 300 }, { 250000, 700 } };
+    static const uint64_t ecmStepWidth = 210;
+
+    static double secondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    static bool isProperDivisor(const BigInt& d, const BigInt& n) {
+        return d != BigInt("1") && d != n;
+    }
+
+    // A proper divisor of the field's odd composite modulus, or 1 when every stage gives up
+    BigInt split(const MontgomeryField& field, std::vector<Stage>& stages) const {
+        const BigInt& n = field.getModulus();
+        if (!n.bit(0)) return BigInt("2");
+
+        auto start = std::chrono::steady_clock::now();
+        BigInt divisor = rho(field);
+        stages[1].seconds += secondsSince(start);
+        if (isProperDivisor(divisor, n)) {
+            ++stages[1].splits;
+            return divisor;
+        }
+
+        start = std::chrono::steady_clock::now();
+        divisor = pMinus1(field);
+        stages[2].seconds += secondsSince(start);
+        if (isProperDivisor(divisor, n)) {
+            ++stages[2].splits;
+            return divisor;
+        }
+
+        uint64_t firstSigma = 6;
+        for (unsigned level = 0; level < std::min(4u, limits.ecmLevels); ++level) {
+            divisor = ecm(field, ecmSchedule[level], firstSigma, stages);
+            if (isProperDivisor(divisor, n)) return divisor;
+            firstSigma += ecmSchedule[level].curves;
+        }
+        return BigInt("1");
+    }
+
+    BigInt rho(const MontgomeryField& field) const {
+        const BigInt& n = field.getModulus();
+        const uint64_t batch = 1024;
+        for (unsigned c = 1; c <= 3; ++c) {
+            Element constant = field.fromBigInt(BigInt(std::to_string(c)));
+            Element y = field.fromBigInt(BigInt("2")), x, saved, q = field.one(), difference;
+            auto step = [&](Element& value) {
+                field.mul(value, value, value);
+                field.add(value, constant, value);
+            };
+
+            // Brent: x stays at y's position of the last power of two, the gcd runs once per batch
+            BigInt g("1");
+            uint64_t steps = 0;
+            for (uint64_t r = 1; g == BigInt("1") && steps < limits.rhoIterations; r *= 2) {
+                x = y;
+                for (uint64_t i = 0; i < r; ++i) step(y);
+                steps += r;
+                for (uint64_t done = 0; done < r && g == BigInt("1"); done += batch) {
+                    saved = y;
+                    uint64_t count = std::min(batch, r - done);
+                    for (uint64_t i = 0; i < count; ++i) {
+                        step(y);
+                        field.sub(x, y, difference);
+                        field.mul(q, difference, q);
+                    }
+                    steps += count;
+                    g = gcd(field.toBigInt(q), n);
+                }
+            }
+            // The batch that hit n may still hide a proper factor: replay it one gcd at a time
+            if (g == n) {
+                do {
+                    step(saved);
+                    field.sub(x, saved, difference);
+                    g = gcd(field.toBigInt(difference), n);
+                } while (g == BigInt("1"));
+            }
+            // Only a cycle that closed modulo n as a whole calls for another constant
+            if (g != n) return g;
+        }
+        return BigInt("1");
+    }
+
+    // Finds p when p - 1 is B1-smooth apart from at most one prime up to B2
+    BigInt pMinus1(const MontgomeryField& field) const {
+        const BigInt& n = field.getModulus();
+        Element a = field.fromBigInt(BigInt("2")), difference;
+        size_t index = 0;
+        for (; index < primes.size() && primes[index] <= limits.pMinus1B1; ++index) {
+            uint64_t p = primes[index], exponent = p;
+            while (exponent <= limits.pMinus1B1 / p) exponent *= p;
+            field.power(a, exponent, a);
+        }
+        field.sub(a, field.one(), difference);
+        BigInt g = gcd(field.toBigInt(difference), n);
+        if (g != BigInt("1") || index == primes.size()) return g;
+
+        // Stage 2: a^q for the following primes q, stepping by the even gaps between them
+        std::vector<Element> gapPowers(1);
+        Element aSquared, x, product = field.one();
+        field.mul(a, a, aSquared);
+        field.power(a, primes[index], x);
+        for (size_t i = index + 1; i < primes.size() && primes[i] <= limits.pMinus1B2; ++i) {
+            size_t gap = (primes[i] - primes[i - 1]) / 2;
+            while (gapPowers.size() <= gap) {
+                gapPowers.push_back(gapPowers.size() == 1 ? aSquared : Element());
+                if (gapPowers.size() > 2) field.mul(gapPowers[gapPowers.size() - 2], aSquared, gapPowers.back());
+            }
+            field.mul(x, gapPowers[gap], x);
+            field.sub(x, field.one(), difference);
+            field.mul(product, difference, product);
+            if (i % 4096 == 0 && field.isZero(product)) break;
+        }
+        return gcd(field.toBigInt(product), n);
+    }
+
+    // Runs the curves of one schedule row on the worker threads until one of them finds a factor
+    BigInt ecm(const MontgomeryField& field, const EcmLevel& level, uint64_t firstSigma, std::vector<Stage>& stages) const {
+        const BigInt& n = field.getModulus();
+        std::atomic<unsigned> nextCurve(0);
+        std::atomic<bool> found(false);
+        std::mutex mutex;
+        BigInt divisor("1");
+
+        auto worker = [&]() {
+            double stage1 = 0, stage2 = 0;
+            for (unsigned curve = nextCurve++; curve < level.curves && !found; curve = nextCurve++) {
+                auto start = std::chrono::steady_clock::now();
+                MontgomeryCurve::Point point;
+                MontgomeryCurve arithmetic(field, firstSigma + curve, point);
+                for (size_t i = 0; i < primes.size() && primes[i] <= level.b1; ++i) {
+                    uint64_t p = primes[i], power = p;
+                    while (power <= level.b1 / p) power *= p;
+                    arithmetic.multiply(point, power, point);
+                }
+                BigInt g = gcd(field.toBigInt(point.z), n);
+                stage1 += secondsSince(start);
+                int stage = 3;
+
+                if (g == BigInt("1")) {
+                    start = std::chrono::steady_clock::now();
+                    g = ecmStage2(field, arithmetic, point, level.b1, 50 * level.b1);
+                    stage2 += secondsSince(start);
+                    stage = 4;
+                }
+                if (isProperDivisor(g, n)) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!found) {
+                        divisor = g;
+                        ++stages[stage].splits;
+                    }
+                    found = true;
+                }
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            stages[3].seconds += stage1;
+            stages[4].seconds += stage2;
+        };
+
+        std::vector<std::thread> workers;
+        for (unsigned i = 1; i < threads; ++i) workers.emplace_back(worker);
+        worker();
+        for (std::thread& thread : workers) thread.join();
+        return divisor;
+    }
+
+    // Baby-step giant-step continuation: q = m D +- j for j < D / 2 coprime to D covers every
+    // prime in (B1, B2], and (m D Q) and (j Q) have equal x exactly when q Q vanishes
+    static BigInt ecmStage2(const MontgomeryField& field, MontgomeryCurve& arithmetic, const MontgomeryCurve::Point& q, uint64_t b1, uint64_t b2) {
+        const uint64_t d = ecmStepWidth;
+        std::vector<MontgomeryCurve::Point> babySteps;
+        MontgomeryCurve::Point previous = q, current = q, twice, next;
+        arithmetic.dbl(q, twice);
+        for (uint64_t j = 1; j < d / 2; j += 2) {
+            if (j > 1) {
+                // (j Q) = ((j - 2) Q) + (2Q), with difference ((j - 4) Q), which is Q for j = 3
+                arithmetic.add(current, twice, j == 3 ? q : previous, next);
+                previous = current;
+                current = next;
+            }
+            if (std::gcd(j, d) == 1) babySteps.push_back(current);
+        }
+
+        MontgomeryCurve::Point step, giant, lastGiant;
+        uint64_t m = std::max<uint64_t>(2, b1 / d);
+        arithmetic.multiply(q, d, step);
+        arithmetic.multiply(step, m - 1, lastGiant);
+        arithmetic.multiply(step, m, giant);
+        Element product = field.one(), left, right;
+        for (; m * d <= b2 + d; ++m) {
+            for (const MontgomeryCurve::Point& baby : babySteps) {
+                field.mul(giant.x, baby.z, left);
+                field.mul(baby.x, giant.z, right);
+                field.sub(left, right, left);
+                field.mul(product, left, product);
+            }
+            arithmetic.add(giant, step, lastGiant, next);
+            lastGiant = std::move(giant);
+            giant = std::move(next);
+        }
+        return gcd(field.toBigInt(product), field.getModulus());
+    }
+
+    unsigned threads;
+    Limits limits;
+    std::vector<unsigned> primes;
+};
+
 template<typename Func, typename... Args>
 auto evaluateExecutionSpeed(Func&& func, Args&&... args) {
     // Record start time
@@ -981,7 +3516,90 @@ auto evaluateExecutionSpeed(Func&& func, Args&&... args) {
     return std::make_pair(result, duration);
 }
 
-int main() {
+// Times every available digit kernel set on 10^4..10^6-digit operands and checks that they agree
+void benchmarkDigitKernels() {
+    std::mt19937_64 rng(12345);
+    std::vector<digitKernels::KernelTable> tables = digitKernels::availableKernels();
+
+    for (size_t digits : { size_t(10000), size_t(100000), size_t(1000000) }) {
+        std::string a(digits, '0'), b(digits, '0');
+        for (size_t i = 0; i < digits; ++i) {
+            a[i] = char('0' + rng() % 10);
+            b[i] = char('0' + rng() % 10);
+        }
+        a[0] = '9';
+        b[0] = '1';
+        int repeats = int(10000000 / digits);
+
+        std::string scalarSum, scalarDiff;
+        long long scalarAddTime = 0, scalarSubTime = 0;
+        for (const auto& table : tables) {
+            std::string sum(digits + 1, '0'), diff(digits, '0');
+            auto addRun = evaluateExecutionSpeed([&]() {
+                for (int r = 0; r < repeats; ++r) table.addShifted(a.data(), a.size(), b.data(), b.size(), 0, &sum[0], sum.size());
+                return sum.size();
+            });
+            auto subRun = evaluateExecutionSpeed([&]() {
+                for (int r = 0; r < repeats; ++r) table.subShifted(a.data(), a.size(), b.data(), b.size(), 0, &diff[0]);
+                return diff.size();
+            });
+            if (scalarSum.empty()) {
+                scalarSum = sum;
+                scalarDiff = diff;
+                scalarAddTime = addRun.second;
+                scalarSubTime = subRun.second;
+            }
+
+            std::cout << digits << " digits, " << table.name
+                << ": add " << addRun.second / repeats << " ns"
+                << " (x" << double(scalarAddTime) / addRun.second << ")"
+                << ", sub " << subRun.second / repeats << " ns"
+                << " (x" << double(scalarSubTime) / subRun.second << ")"
+                << ((sum == scalarSum && diff == scalarDiff) ? "" : "  MISMATCH") << std::endl;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "--bench-kernels") {
+        benchmarkDigitKernels();
+        return 0;
+    }
+    if (argc > 2 && std::string(argv[1]) == "--primes") {
+        // --primes <file|-> [threads]: one candidate per line in, "<candidate> <verdict>" lines out
+        unsigned threads = argc > 3 ? unsigned(std::stoul(argv[3])) : std::thread::hardware_concurrency();
+        PrimalityCache cache;
+        BatchPrimalityTester tester(threads, 5, 4096, &cache);
+        std::string path = argv[2];
+        BatchPrimalityTester::Report report = path == "-" ? tester.run(std::cin, std::cout) : tester.runFile(path, std::cout);
+        report.print(std::cerr);
+        PrimalityCache::Stats cacheStats = cache.stats();
+        std::cerr << "cache: " << cacheStats.hits << " hits, " << cacheStats.misses << " misses, " << cacheStats.entries << " entries\n";
+        return 0;
+    }
+
+
+    if (argc > 2 && std::string(argv[1]) == "--factor") {
+        // --factor <n> [threads]: "<n> = <p1> * <p2> * ..." out, per-stage timings on stderr
+        unsigned threads = argc > 3 ? unsigned(std::stoul(argv[3])) : std::thread::hardware_concurrency();
+        BigInt n(argv[2]);
+        Factorizer::Result result = Factorizer(threads).factor(n);
+        std::cout << n << " =";
+        const char* separator = " ";
+        for (const BigInt& factor : result.factors) {
+            std::cout << separator << factor;
+            separator = " * ";
+        }
+        for (const BigInt& part : result.unfactored) {
+            std::cout << separator << "[" << part << "]";
+            separator = " * ";
+        }
+        std::cout << std::endl;
+        result.print(std::cerr);
+        return result.unfactored.empty() ? 0 : 1;
+    }
+
+
     BigInt num1("-5");
     BigInt num2("-13");
 
@@ -998,6 +3616,11 @@ int main() {
     BigRational rational2(num6, den2);
 
 
+    // Harmonic number H(100) summed by binary splitting
+    std::vector<BigRational> harmonic;
+    for (int i = 1; i <= 100; ++i) harmonic.emplace_back(BigInt("1"), BigInt(std::to_string(i)));
+    std::cout << "H(100) = " << sum(harmonic) << std::endl;
+
     TBigRational<int> rational3(20, 20);
     TBigRational<int> rational4(-5, 5);
 
@@ -1040,6 +3663,14 @@ int main() {
 
     // Lucas-Lehmer Primality Test
     std::cout << prime3 << " is " << (lucasLehmerTest(prime3) ? "prime." : "not prime.") << std::endl;
+
+    // Fixed-width Miller-Rabin on 2^255 - 19
+    BigUInt<256> prime4 = (BigUInt<256>(1) << 255) - BigUInt<256>(19);
+    std::cout << prime4 << " is " << (millerRabin(prime4) ? "prime." : "not prime.") << std::endl;
+
+#ifdef BIGINT_INSTRUMENTATION
+    instrumentation::dumpJson(std::cout);
+#endif
     
     return 0;
 }